@@ -11,23 +11,181 @@
 #ifdef USE_OSC
 #include <ArdOSCForWiFlyHQ.h>
 OSCServer* globalArduParOscServer=0;	///< you can set this to something to avoid having to pass a server for each setting setup.
+void addParameterOscServer(OSCServer* server);
 #endif
 
 #define DEBUG 0
 #define TRACE(x) do { if (DEBUG) Serial.print( x); } while (0)
 #define TRACELN(x) do { if (DEBUG) Serial.println( x); } while (0)
 
+// runtime statistics per setting and for the library as a whole. Define this as 1 before including ArduPar.h to enable them.
+// Like the TRACE macros, PAR_STAT(x) leaves no code behind when they are disabled. See ArduParStats.h.
+#ifndef PAR_SETTINGS_STATS
+#define PAR_SETTINGS_STATS 0
+#endif
+#if PAR_SETTINGS_STATS
+#define PAR_STAT(x) do { x; } while (0)
+#else
+#define PAR_STAT(x) do { } while (0)
+#endif
+
 // the instances of classes derived from AbstractArduPar maintain a global list. You can change the maximum number of settings here.
+#ifndef PAR_SETTINGS_MAX_NUMBER
 #define PAR_SETTINGS_MAX_NUMBER 32
+#endif
 
-//this determines the maximum parameter command length
-#define PAR_SETTINGS_BUFFER_SIZE 32
+//this determines the maximum parameter command length. A batch of commands separated by ';' has to fit as a whole.
+#ifndef PAR_SETTINGS_BUFFER_SIZE
+#define PAR_SETTINGS_BUFFER_SIZE 64
+#endif
 class AbstractArduPar;
 AbstractArduPar* PAR_SETTINGS_INSTANCES[PAR_SETTINGS_MAX_NUMBER];
 int PAR_SETTINGS_CUR_INSTANCE_NUMBER=0;
 
+// commands are looked up in a hash table that holds (instance number + 1), 0 marks a free slot.
+// It is twice as large as the instance list to keep probe sequences short.
+#define PAR_SETTINGS_INDEX_SIZE (2*PAR_SETTINGS_MAX_NUMBER)
+#if PAR_SETTINGS_MAX_NUMBER<255
+typedef uint8_t ArduParIndexSlot;
+#else
+typedef uint16_t ArduParIndexSlot;
+#endif
+ArduParIndexSlot PAR_SETTINGS_INDEX[PAR_SETTINGS_INDEX_SIZE];
+bool PAR_SETTINGS_INDEX_VALID=false;	///< cleared whenever an instance is registered, the index is rebuilt on the next lookup
+
+// settings that stand for a whole table of values (see TableArduPar) are not in the index. Commands that are not found there are offered to them.
+#ifndef PAR_SETTINGS_MAX_TABLES
+#define PAR_SETTINGS_MAX_TABLES 2
+#endif
+AbstractArduPar* PAR_SETTINGS_TABLES[PAR_SETTINGS_MAX_TABLES];
+int PAR_SETTINGS_CUR_TABLE_NUMBER=0;
+
+// change notifications wait in queues until dispatchParameterChanges() is called. See AbstractArduPar::onChange().
+#ifndef PAR_SETTINGS_MAX_CHANGE_GROUPS
+#define PAR_SETTINGS_MAX_CHANGE_GROUPS 4
+#endif
+
+#if PAR_SETTINGS_STATS
+/// counters of a single setting. They wrap around after 65535.
+struct ArduParStats{
+  uint16_t updates;				///< updates received by serial commands, binary frames or OSC
+  uint16_t clamped;				///< values that were constrained to the bounds
+  uint16_t parseErrors;			///< received values that were not understood
+  uint16_t eepromBytes;			///< bytes written to eeprom
+  unsigned long lastUpdateMillis;	///< millis() at the last update that was received
+};
+
+/// time spent in the library and commands that did not reach any setting
+struct ArduParLibraryStats{
+  unsigned long parseMicros;		///< in updateParametersFromStream(), including the eeprom writes it caused
+  unsigned long dispatchMicros;		///< in dispatchParameterChanges(), including the callbacks
+  unsigned long eepromMicros;		///< writing values to eeprom
+  uint16_t unknownCommands;		///< commands and messages for settings that do not exist, rejected frames and commands that were too long
+};
+ArduParLibraryStats PAR_SETTINGS_LIBRARY_STATS;
+#endif
+
+/// Several settings that share one change callback. The callback is called once per dispatch, no matter how many of them changed.
+/// Add settings with AbstractArduPar::setChangeGroup().
+struct ArduParChangeGroup{
+  void (*callback)();		///< called by dispatchParameterChanges() if a member changed since the last dispatch
+  bool changePending;		///< a member changed and the group is queued. Managed by the library.
+};
+
+// persistent settings can be kept in a wear leveled log instead of fixed eeprom adresses. See beginParameterLog().
+#ifndef PAR_LOG_STORE_MAX_KEYS
+#define PAR_LOG_STORE_MAX_KEYS PAR_SETTINGS_MAX_NUMBER
+#endif
+#include "ArduParLogStore.h"
+
+// persistent settings can be loaded from a validated image of the eeprom, after all of them were set up. See beginParameterImage().
+int PAR_SETTINGS_IMAGE_ADRESS=-1;	///< eeprom adress of the image header, -1 if there is no image
+int PAR_SETTINGS_IMAGE_END=-1;		///< eeprom adress after the image, -1 while settings are added to it
+bool PAR_SETTINGS_IMAGE_CRC_DIRTY=false;	///< values of the image were written since its crc was
+bool isInParameterImage(AbstractArduPar* par);
+void updateParameterImageCrc();
+
+// values that arrive from a host are not sent back to it, unless they had to be clamped. See ArduParFeedbackPublisher.
+AbstractArduPar* PAR_SETTINGS_RECEIVING=0;	///< the setting a received value is given to right now, 0 otherwise
+bool PAR_SETTINGS_VALUE_CLAMPED=false;		///< the value that is set right now was constrained to the bounds
+
+// values can be derived from settings. See DerivedArduPar.
+void markDerivedParametersDirty(AbstractArduPar* source);
+
+/// true if the value at "adress" is part of a parameter image that was not loaded yet. Such values are not read by setup().
+bool isParameterImagePending(int adress){
+  return PAR_SETTINGS_IMAGE_ADRESS>=0&&PAR_SETTINGS_IMAGE_END<0&&adress>PAR_SETTINGS_IMAGE_ADRESS&&adress<EepromAdressManager::nextFreeAdress;
+}
+
+/// Take a value of type T from stored bytes if it is within the bounds. Also rejects NaN. Used by AbstractArduPar::loadValue().
+template<typename T> bool loadBoundedValue(const uint8_t* data, T* value, T minValue, T maxValue){
+  T newValue;
+  memcpy(&newValue,data,sizeof(T));
+  if(!(newValue>=minValue&&newValue<=maxValue))return false;
+  *value=newValue;
+  return true;
+}
+
 //strcmp_P( _mes->_oscAddress,(const char PROGMEM *) sinks[i]-> getAdress()) == 0
 
+/// hash of a parameter name in RAM. Has to give the same result as hashParameterName_P for the same string.
+uint16_t hashParameterName(const char* name, int length){
+  uint16_t hash=5381;
+  for(int i=0;i<length;i++)hash=(hash<<5)+hash+(uint8_t)name[i];
+  return hash;
+}
+
+/// hash of a parameter name in program memory.
+uint16_t hashParameterName_P(const char PROGMEM * name){
+  uint16_t hash=5381;
+  uint8_t c;
+  while((c=pgm_read_byte(name++))!=0)hash=(hash<<5)+hash+c;
+  return hash;
+}
+
+#if PAR_SETTINGS_STATS
+/// true if "data" starts with a number after optional spaces. Received values that do not are counted as parse errors.
+bool isNumberText(const char* data){
+  while(*data==' ')data++;
+  if(*data=='-'||*data=='+')data++;
+  if(*data=='.')data++;
+  return *data>='0'&&*data<='9';
+}
+#endif
+
+/// compare two strings that are both in program memory
+bool samePgmString(const char PROGMEM * a, const char PROGMEM * b){
+  uint8_t c;
+  do{
+    c=pgm_read_byte(a++);
+    if(c!=pgm_read_byte(b++))return false;
+  }while(c!=0);
+  return true;
+}
+
+/// A value that arrived in binary form, i.e. in a binary frame. The type tags follow the C types of the settings.
+struct ArduParArgument{
+  char typeTag;             ///< 'i' 16 bit int, 'l' 32 bit int, 'f' float, 's' zero terminated string, 'b' blob of raw bytes, 't' no value (trigger)
+  long intValue;            ///< holds 'i' and 'l' arguments, and the size of 'b' arguments
+  float floatValue;         ///< holds 'f' arguments
+  const char* stringValue;  ///< holds 's' arguments and the bytes of 'b' arguments
+
+  /// the argument converted to an integer
+  long asLong(){
+    if(typeTag=='i'||typeTag=='l')return intValue;
+    if(typeTag=='f')return (long)floatValue;
+    if(typeTag=='s')return atol(stringValue);
+    return 0;
+  }
+  /// the argument converted to a float
+  float asFloat(){
+    if(typeTag=='i'||typeTag=='l')return (float)intValue;
+    if(typeTag=='f')return floatValue;
+    if(typeTag=='s')return atof(stringValue);
+    return 0;
+  }
+};
+
 /// A common interface for all kinds of parameter settings.
 class AbstractArduPar
 #ifdef USE_OSC
@@ -39,6 +197,20 @@ public:
    const __FlashStringHelper* cmdString;           ///< serial input is parsed for this command string, anything that follows is interpreted as parameter data
   int cmdStringLength;                            ///< used for comparisons
   bool valueReceived;								///< indicates that a new value was received either from a Stream or by OSC. Set to false to be notified again.
+  int eepromAdress;								///< an adress in eeprom memory for permanent storage of the parameter value. When <0 no storage will happen
+  bool valueDirty;								///< the value was changed but not written to eeprom yet. Only used when persistence is deferred.
+  bool persistInLog;							///< the value is kept in the ArduParLogStore instead of at eepromAdress
+  void (*changeCallback)(AbstractArduPar* changed);	///< called by dispatchParameterChanges() after the value changed. 0 for none.
+  ArduParChangeGroup* changeGroup;				///< group that is notified when the value changed. 0 for none.
+  bool changePending;							///< the value changed and the setting is queued for dispatchParameterChanges()
+  uint16_t changeSequence;						///< value of PAR_SETTINGS_CHANGE_SEQUENCE at the last change. 0 if it never changed.
+  bool changeReceived;							///< the last change was a received value that was taken as it was, so the host knows it already
+#ifdef USE_OSC
+  bool oscEnabled;								///< the setting was set up with an OSC server and can be reached by OSC messages
+#endif
+#if PAR_SETTINGS_STATS
+  ArduParStats stats;							///< runtime statistics. Only there if PAR_SETTINGS_STATS is enabled.
+#endif
  /// Initialize the setting. Has to be called for the setting to become usable.
   void setup(
    const __FlashStringHelper* cmdString	///< serial input is parsed for this command string, anything that follows is interpreted as parameter data
@@ -51,41 +223,188 @@ public:
 	this->cmdString=cmdString;
 	this->cmdStringLength=strlen_P((const char PROGMEM *)cmdString);
     valueReceived=false;
+    eepromAdress=-1;
+    valueDirty=false;
+    persistInLog=false;
+    changeCallback=0;
+    changeGroup=0;
+    changePending=false;
+    changeSequence=0;
+    changeReceived=false;
+    PAR_STAT(memset(&stats,0,sizeof(stats)));
     //register instance in the global array
     if(PAR_SETTINGS_CUR_INSTANCE_NUMBER<PAR_SETTINGS_MAX_NUMBER){
       PAR_SETTINGS_INSTANCES[PAR_SETTINGS_CUR_INSTANCE_NUMBER]=this;
       PAR_SETTINGS_CUR_INSTANCE_NUMBER++;
+      PAR_SETTINGS_INDEX_VALID=false;
     }
     else{
       Serial.print(F("Max Parsetting instances exceeded, could not register"));
       Serial.println(cmdString);
     }
 #ifdef USE_OSC
+	oscEnabled=(server!=0);
 	if(server!=0){
     TRACE((F("New osc cmd: ")));
 	TRACELN((cmdString));
-		server->addOscMessageSink(this);
+		addParameterOscServer(server);	//the server hands messages to the ArduParOscRouter, which finds the setting
 	}
 #endif
 }
 
-/// digest incoming serial data that potentially contains a "set" command
+/// digest incoming serial data that potentially contains a "set" command.
+/// The command has to match exactly, followed by white space or the end of the data.
+/// updateParametersFromStream() does not call this for every instance anymore but uses findParameter().
   virtual void parseSerialData(char* data)        
   {
     TRACE((F("Matching serial cmd")));
 	TRACE((cmdString));
 	TRACE((F("to")));
     TRACELN((data));
-    int foundPos=strncmp_P(data,(const char PROGMEM *)cmdString,cmdStringLength);
-	
-    if(foundPos==0){
+    if(matchesName(data,parameterNameLength(data))){
 		TRACE(F("matched:"));
 		TRACELN((cmdString));
-		parseParameterString(data+ strlen_P((const char PROGMEM *)cmdString));
+		receiveString(data+cmdStringLength);
     }
   }
+
+  /// Give a received string to parseParameterString(). Changes that come in this way are marked with changeReceived.
+  void receiveString(char* data){
+    PAR_SETTINGS_RECEIVING=this;
+    parseParameterString(data);
+    PAR_SETTINGS_RECEIVING=0;
+    PAR_SETTINGS_VALUE_CLAMPED=false;
+  }
+  /// Give a received argument to setValueFromArgument(), like receiveString().
+  void receiveArgument(ArduParArgument* arg){
+    PAR_SETTINGS_RECEIVING=this;
+    setValueFromArgument(arg);
+    PAR_SETTINGS_RECEIVING=0;
+    PAR_SETTINGS_VALUE_CLAMPED=false;
+  }
+  /// Called by derived classes when a value had to be constrained to the bounds. The host learns the value that was taken.
+  void valueClamped(){
+    PAR_STAT(stats.clamped++);
+    PAR_SETTINGS_VALUE_CLAMPED=true;
+  }
+
+  /// true if the first "length" chars of "name" are exactly the command string of this setting
+  bool matchesName(const char* name, int length){
+    return length==cmdStringLength && strncmp_P(name,(const char PROGMEM *)cmdString,length)==0;
+  }
+
+  /// the length of the parameter name at the start of a command. It ends at the first white space, or at the '[' of an array index.
+  static int parameterNameLength(const char* command){
+    int length=0;
+    while(command[length]>' '&&command[length]!='[')length++;
+    return length;
+  }
   
   virtual void parseParameterString(char* data)=0;    ///< derived classed implement parsing and setting parameters from a string here
+  virtual void setValueFromArgument(ArduParArgument* arg){}  ///< derived classes set their value from a binary argument here, converting it if necessary
+  virtual void* getValueData(){return 0;}            ///< derived classes with a value return its location here. This is what gets stored in eeprom.
+  virtual int getValueSize(){return 0;}              ///< number of bytes at getValueData()
+  virtual bool getValueArgument(ArduParArgument* arg){return false;}  ///< derived classes with a value give it as an argument here, i.e. to send it back to a host. false if there is none.
+  virtual void valueLoaded(){valueReceived=true;persistValue();}  ///< called after the memory at getValueData() was overwritten as a whole, i.e. by recalling a preset. Derived classes check the value here.
+  virtual bool interpolateValue(const void* from, const void* to, uint16_t fraction){return false;}  ///< numeric settings set their value "fraction"/256 of the way between two raw values here, without persisting it. false if they can not.
+  virtual bool isArray(){return false;}              ///< true for settings that accept an index range after their name, like "seq[2..5] 1 2 3 4"
+  virtual bool isTable(){return false;}              ///< true for settings that hold several values with their own names. They are asked with selectEntry() instead of being indexed.
+  virtual bool selectEntry(const char* name, int length){return false;}  ///< tables make the value with the given name the current one. Returns false if there is none.
+  virtual int getStorageAdress(){return eepromAdress;}   ///< first eeprom adress of everything the setting stores. Differs from eepromAdress for tables.
+  virtual int getStorageSize(){return getValueSize();}   ///< number of bytes the setting stores at getStorageAdress()
+  /// Take the value from the bytes that were stored at getStorageAdress(), as read by loadParameterImage(). Derived classes check the bounds here.
+  /// Returns false and keeps the current value if the stored one is not valid.
+  virtual bool loadValue(const uint8_t* data){memcpy(getValueData(),data,getValueSize());return true;}
+  virtual void publishValue(){}  ///< called whenever the value changed. PublishedArduPar hands it to interrupt routines here.
+  /// write everything the setting stores to eeprom, changed or not
+  virtual void storeValue(){if(eepromAdress>=0)eeprom_update_block(getValueData(),(void*)eepromAdress,getValueSize());}
+
+  /// true if the value is stored in eeprom, either at a fixed adress or in the log
+  bool isPersistent(){return eepromAdress>=0||persistInLog;}
+
+  /// the key that identifies the value in the ArduParLogStore
+  uint16_t getLogKey(){return hashParameterName_P((const char PROGMEM *)cmdString);}
+
+  /// Find a place in eeprom for the value and initialize the value from there. Called by the setup() of derived classes once getValueData() is valid.
+  /// Unless a fixed adress is given, values go to the ArduParLogStore if beginParameterLog() was called, otherwise they get the next free adress from the EepromAdressManager.
+  void setupPersistence(
+    boolean isPersistent,		///< if false, the value is neither read nor stored
+    int fixedEEPROMAdress		///< a specific adress for the value, or -1 to assign one automatically
+  ){
+    if(!isPersistent){
+      eepromAdress=-1; // used to signal non-persistence to other methods
+      return;
+    }
+    if(fixedEEPROMAdress==-1&&ArduParLogStore::isActive()){
+      persistInLog=true;
+      for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+        AbstractArduPar* other=PAR_SETTINGS_INSTANCES[i];
+        if(other!=this&&other->persistInLog&&other->getLogKey()==getLogKey()){
+          Serial.print(F("Parameter log key collision: "));
+          Serial.println(cmdString);
+        }
+      }
+      TRACE((F("Init from parameter log. Key: ")));
+      TRACE((getLogKey()));
+      ArduParLogStore::read(getLogKey(),getValueData(),getValueSize());	//keeps the current value if nothing was stored yet
+      return;
+    }
+    if(fixedEEPROMAdress==-1){TRACE((F("Getting EEPROM. Adress: ")));fixedEEPROMAdress=EepromAdressManager::getAdressFor(getValueSize());};
+    eepromAdress=fixedEEPROMAdress;
+    TRACE((F("Init from EEPROM. Adress: ")));
+    TRACE((int)(eepromAdress));
+    if(isParameterImagePending(eepromAdress)){TRACELN((F(" (from image)")));return;}	//loadParameterImage() reads and checks it
+    eeprom_read_block(getValueData(),(void *) eepromAdress,getValueSize());
+  }
+
+  /// Call "callback" once the value changed. Calls are deferred to dispatchParameterChanges(), so a burst of updates gives one call with the final value.
+  /// Has to be called after setup().
+  void onChange(void (*callback)(AbstractArduPar* changed)){changeCallback=callback;}
+  /// Notify "group" when the value changed. Has to be called after setup().
+  void setChangeGroup(ArduParChangeGroup* group){changeGroup=group;}
+  /// queue the change notifications of this setting and remember when it changed. Called by persistValue().
+  void queueChangeNotification();
+#if PAR_SETTINGS_STATS
+  /// count an update that was received. Called by whatever hands received values to the setting.
+  void countUpdate(){
+    stats.updates++;
+    stats.lastUpdateMillis=millis();
+  }
+#endif
+
+  /// Called by derived classes after their value was set. Queues change notifications and stores the value in eeprom.
+  /// If persistence is deferred, the setting is only marked dirty and written by commitParameters().
+  void persistValue();
+  /// write the bytes of the value that differ from the eeprom contents, if "maxBytes" is not 0 (-1 for no limit).
+  /// The value is always written as a whole, even if that takes more than "maxBytes".
+  /// Returns the number of bytes written. The dirty flag is cleared when the eeprom is up to date.
+  virtual int writeChangedBytes(int maxBytes=-1){
+    if(!isPersistent()){valueDirty=false;return 0;}
+    const uint8_t* data=(const uint8_t*)getValueData();
+    int size=getValueSize();
+    int written=0;
+    if(persistInLog){
+      //a record can only be written as a whole. It may exceed the rest of a budget that is not used up yet.
+      if(!ArduParLogStore::isStored(getLogKey(),data,size)){
+        if(maxBytes==0)return 0;
+        written=ArduParLogStore::write(getLogKey(),data,size);
+      }
+      valueDirty=false;
+      return written;
+    }
+    //the value is written as a whole too, so a reset never leaves it half old and half new in eeprom
+    int first=0;
+    while(first<size&&eeprom_read_byte((uint8_t*)(eepromAdress+first))==data[first])first++;
+    if(first<size&&maxBytes==0)return 0;   //budget used up, stay dirty
+    for(int i=first;i<size;i++){
+      uint8_t* adress=(uint8_t*)(eepromAdress+i);
+      if(eeprom_read_byte(adress)==data[i])continue;
+      eeprom_write_byte(adress,data[i]);
+      written++;
+    }
+    valueDirty=false;
+    return written;
+  }
   virtual void dumpParameterInfo(Stream* out)=0;       ///< derived classed can give some information about semselves this way. preferably in a machine-readable way.
 
 //optional osc support
@@ -96,11 +415,241 @@ public:
   }
   /// Return true is the message OSC Adress is identical to that of the setting.
   boolean isOscMessageForMe(OSCMessage* mes){return (strcmp_P( mes->getOSCAddress(),(const char PROGMEM *) this->getAdress()) == 0);};
+  /// derived classes set their value from the arguments of a message that was sent to them here
+  virtual void applyOscMessage(OSCMessage* mes){}
+  /// Only used if the setting was added to an OSCServer by hand. Settings that were set up with a server are reached through the ArduParOscRouter.
+  void digestMessage(OSCMessage* mes){
+    if(isOscMessageForMe(mes))receiveOscMessage(mes);
+  }
+  /// Give a received message to applyOscMessage(), like receiveString().
+  void receiveOscMessage(OSCMessage* mes){
+    PAR_SETTINGS_RECEIVING=this;
+    applyOscMessage(mes);
+    PAR_SETTINGS_RECEIVING=0;
+    PAR_SETTINGS_VALUE_CLAMPED=false;
+  }
 #endif
 
 };
 
 
+/// controls when values of persistent settings are written to eeprom
+struct ArduParPersistenceSettings{
+  bool deferred;                    ///< if true, setting a value only touches RAM. Changed values are written by commitParameters() or flushParameters().
+  unsigned long minCommitInterval;  ///< minimum time in ms between two commitParameters() calls that write to eeprom. Changes within this time are coalesced.
+  int maxBytesPerCommit;            ///< maximum number of bytes written by one commitParameters() call. Each byte blocks for about 3.3ms on AVR. -1 for no limit.
+};
+// A commit never stops within a value: each number, string, array element or log record is written as a whole, so a reset can not
+// leave a value that is half old and half new in eeprom. The last value of a commit may therefore take more than what is left of
+// maxBytesPerCommit, i.e. a 20 char string is written in one commit even with the default budget of 4 bytes.
+/// Change this to defer eeprom writes. i.e. PAR_SETTINGS_PERSISTENCE.deferred=true;
+ArduParPersistenceSettings PAR_SETTINGS_PERSISTENCE={false,1000,4};
+int PAR_SETTINGS_BATCH_DEPTH=0;				///< >0 while a batch of updates is applied. See beginParameterBatch().
+unsigned long PAR_SETTINGS_LAST_COMMIT_MILLIS=0;	///< time of the last commitParameters() run that found something to write
+int PAR_SETTINGS_COMMIT_CURSOR=0;				///< commitParameters() continues with this instance
+
+AbstractArduPar* PAR_SETTINGS_CHANGED_INSTANCES[PAR_SETTINGS_MAX_NUMBER];	///< settings with a change callback that changed since the last dispatch
+int PAR_SETTINGS_NUM_CHANGED_INSTANCES=0;
+ArduParChangeGroup* PAR_SETTINGS_CHANGED_GROUPS[PAR_SETTINGS_MAX_CHANGE_GROUPS];	///< groups with a member that changed since the last dispatch
+int PAR_SETTINGS_NUM_CHANGED_GROUPS=0;
+uint16_t PAR_SETTINGS_CHANGE_SEQUENCE=0;	///< counts value changes. Used by dumpChangedParameterInfos().
+
+void AbstractArduPar::queueChangeNotification(){
+  publishValue();
+  markDerivedParametersDirty(this);
+  PAR_SETTINGS_CHANGE_SEQUENCE++;
+  if(PAR_SETTINGS_CHANGE_SEQUENCE==0)PAR_SETTINGS_CHANGE_SEQUENCE=1;	//0 is reserved for "never changed"
+  changeSequence=PAR_SETTINGS_CHANGE_SEQUENCE;
+  changeReceived=(PAR_SETTINGS_RECEIVING==this&&!PAR_SETTINGS_VALUE_CLAMPED);
+  PAR_SETTINGS_VALUE_CLAMPED=false;
+  if(changeCallback!=0&&!changePending&&PAR_SETTINGS_NUM_CHANGED_INSTANCES<PAR_SETTINGS_MAX_NUMBER){
+    changePending=true;
+    PAR_SETTINGS_CHANGED_INSTANCES[PAR_SETTINGS_NUM_CHANGED_INSTANCES++]=this;
+  }
+  if(changeGroup!=0&&!changeGroup->changePending){
+    if(PAR_SETTINGS_NUM_CHANGED_GROUPS<PAR_SETTINGS_MAX_CHANGE_GROUPS){
+      changeGroup->changePending=true;
+      PAR_SETTINGS_CHANGED_GROUPS[PAR_SETTINGS_NUM_CHANGED_GROUPS++]=changeGroup;
+    }else{
+      Serial.println(F("Max change groups exceeded"));
+    }
+  }
+}
+
+/// write what changed in a setting to eeprom, counting bytes and time in the statistics
+int writeParameterBytes(AbstractArduPar* par, int maxBytes){
+#if PAR_SETTINGS_STATS
+  unsigned long start=micros();
+#endif
+  int written=par->writeChangedBytes(maxBytes);
+  if(written>0&&isInParameterImage(par))PAR_SETTINGS_IMAGE_CRC_DIRTY=true;	//the crc is written once the commit is done
+  PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.eepromMicros+=micros()-start);
+  PAR_STAT(par->stats.eepromBytes+=written);
+  return written;
+}
+
+void AbstractArduPar::persistValue(){
+  queueChangeNotification();
+  if(!isPersistent())return;
+  if(PAR_SETTINGS_PERSISTENCE.deferred||PAR_SETTINGS_BATCH_DEPTH>0){
+    valueDirty=true;
+    return;
+  }
+  TRACE((F("Writing EEProm adress")));
+  TRACE(eepromAdress);
+  TRACE((F("\n")));
+  writeParameterBytes(this,-1);
+  updateParameterImageCrc();
+}
+
+/// Write changed values to eeprom, no more than "budget" bytes (-1 for no limit), regardless of the commit interval.
+/// "foundDirty" tells if there was anything to write. Returns the number of bytes written. Used by commitParameters() and serviceParameters().
+int writeDirtyParameters(int budget, bool* foundDirty){
+  int written=0;
+  *foundDirty=false;
+  //continue where the last call stopped, so every setting gets its turn even with a small budget
+  for(int n=0;n<PAR_SETTINGS_CUR_INSTANCE_NUMBER;n++){
+    if(PAR_SETTINGS_COMMIT_CURSOR>=PAR_SETTINGS_CUR_INSTANCE_NUMBER)PAR_SETTINGS_COMMIT_CURSOR=0;
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[PAR_SETTINGS_COMMIT_CURSOR];
+    if(par->valueDirty){
+      *foundDirty=true;
+      written+=writeParameterBytes(par,budget<0?-1:max(budget-written,0));
+      if(par->valueDirty)break;  //budget used up
+    }
+    PAR_SETTINGS_COMMIT_CURSOR++;
+  }
+  return written;
+}
+
+/// Write values that were changed since the last commit to eeprom. Call this regularly, i.e. in loop() when persistence is deferred.
+/// Does nothing if the last commit was less than PAR_SETTINGS_PERSISTENCE.minCommitInterval ago and writes at most PAR_SETTINGS_PERSISTENCE.maxBytesPerCommit bytes.
+/// Returns the number of bytes written.
+int commitParameters(){
+  if(millis()-PAR_SETTINGS_LAST_COMMIT_MILLIS<PAR_SETTINGS_PERSISTENCE.minCommitInterval)return 0;
+  bool foundDirty;
+  int written=writeDirtyParameters(PAR_SETTINGS_PERSISTENCE.maxBytesPerCommit,&foundDirty);
+  if(foundDirty)PAR_SETTINGS_LAST_COMMIT_MILLIS=millis();
+  updateParameterImageCrc();
+  return written;
+}
+
+/// Write all changed values to eeprom right now, regardless of interval and budget. Call this before shutting down.
+int flushParameters(){
+  int written=0;
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    if(PAR_SETTINGS_INSTANCES[i]->valueDirty)written+=writeParameterBytes(PAR_SETTINGS_INSTANCES[i],-1);
+  }
+  updateParameterImageCrc();
+  PAR_SETTINGS_LAST_COMMIT_MILLIS=millis();
+  return written;
+}
+
+/// Call the change callbacks of all settings and groups that changed since the last call, once each, in the order they changed.
+/// Call this in loop() at a point where your code can deal with new values. Nothing happens while a batch is applied.
+/// Changes made by the callbacks are dispatched by the next call. Returns the number of callbacks that were called.
+/// With "maxCalls", no more callbacks than that are called, and the others wait for the next call.
+int dispatchParameterChanges(int maxCalls=-1){
+  if(PAR_SETTINGS_BATCH_DEPTH>0)return 0;
+#if PAR_SETTINGS_STATS
+  unsigned long start=micros();
+#endif
+  int calls=0;
+  int numInstances=PAR_SETTINGS_NUM_CHANGED_INSTANCES;
+  if(maxCalls>=0&&numInstances>maxCalls)numInstances=maxCalls;
+  for(int i=0;i<numInstances;i++){
+    AbstractArduPar* par=PAR_SETTINGS_CHANGED_INSTANCES[i];
+    par->changePending=false;		//cleared first, so the callback can queue the setting again
+    par->changeCallback(par);
+    calls++;
+  }
+  //keep what the callbacks queued
+  PAR_SETTINGS_NUM_CHANGED_INSTANCES-=numInstances;
+  memmove(PAR_SETTINGS_CHANGED_INSTANCES,PAR_SETTINGS_CHANGED_INSTANCES+numInstances,PAR_SETTINGS_NUM_CHANGED_INSTANCES*sizeof(AbstractArduPar*));
+  int numGroups=PAR_SETTINGS_NUM_CHANGED_GROUPS;
+  if(maxCalls>=0&&numGroups>maxCalls-calls)numGroups=maxCalls-calls;
+  for(int i=0;i<numGroups;i++){
+    ArduParChangeGroup* group=PAR_SETTINGS_CHANGED_GROUPS[i];
+    group->changePending=false;
+    group->callback();
+    calls++;
+  }
+  PAR_SETTINGS_NUM_CHANGED_GROUPS-=numGroups;
+  memmove(PAR_SETTINGS_CHANGED_GROUPS,PAR_SETTINGS_CHANGED_GROUPS+numGroups,PAR_SETTINGS_NUM_CHANGED_GROUPS*sizeof(ArduParChangeGroup*));
+  PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.dispatchMicros+=micros()-start);
+  return calls;
+}
+
+/// Start a batch of updates that belong together. Until the matching endParameterBatch(), values are only changed in RAM.
+/// Batches can be nested.
+void beginParameterBatch(){
+  PAR_SETTINGS_BATCH_DEPTH++;
+}
+
+/// Finish a batch of updates. Values that changed are written to eeprom in one pass, unless persistence is deferred anyway.
+void endParameterBatch(){
+  if(PAR_SETTINGS_BATCH_DEPTH==0)return;
+  PAR_SETTINGS_BATCH_DEPTH--;
+  if(PAR_SETTINGS_BATCH_DEPTH==0&&!PAR_SETTINGS_PERSISTENCE.deferred)flushParameters();
+}
+
+/// true if a registered setting keeps its value in the log under this key. Used to drop values of removed settings when the log is compacted.
+bool isParameterLogKeyInUse(uint16_t key){
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    if(par->persistInLog&&par->getLogKey()==key)return true;
+  }
+  return false;
+}
+
+/// Keep persistent settings in a wear leveled log instead of fixed eeprom adresses. Call this in setup() before setting up any settings.
+/// Values are found by a hash of their command string, so they survive adding, removing and reordering settings.
+/// The log takes "size" bytes from the EepromAdressManager, by default all the eeprom that is still free.
+/// Settings with a fixed eeprom adress are not affected.
+void beginParameterLog(int size=-1){
+  if(size<0)size=E2END+1-EepromAdressManager::nextFreeAdress;
+  ArduParLogStore::begin(EepromAdressManager::getAdressFor(size),size,&isParameterLogKeyInUse);
+}
+
+/// (re)build the hash table that maps command strings to instances. Called automatically on the first lookup after a setup().
+void buildParameterIndex(){
+  memset(PAR_SETTINGS_INDEX,0,sizeof(PAR_SETTINGS_INDEX));
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    if(par->isTable())continue;
+    unsigned int slot=hashParameterName_P((const char PROGMEM *)par->cmdString)%PAR_SETTINGS_INDEX_SIZE;
+    //linear probing. The table is never more than half full, so there is always a free slot.
+    bool duplicate=false;
+    while(PAR_SETTINGS_INDEX[slot]!=0&&!duplicate){
+      AbstractArduPar* other=PAR_SETTINGS_INSTANCES[PAR_SETTINGS_INDEX[slot]-1];
+      duplicate=samePgmString((const char PROGMEM *)other->cmdString,(const char PROGMEM *)par->cmdString);
+      slot=(slot+1)%PAR_SETTINGS_INDEX_SIZE;
+    }
+    if(duplicate){
+      //the first setting with a name keeps it
+      Serial.print(F("Duplicate setting, ignoring "));
+      Serial.println(par->cmdString);
+    }else{
+      PAR_SETTINGS_INDEX[slot]=i+1;
+    }
+  }
+  PAR_SETTINGS_INDEX_VALID=true;
+}
+
+/// find the setting with exactly the given name. returns 0 if there is none. For tables, the entry with the name is selected.
+AbstractArduPar* findParameter(const char* name, int length){
+  if(!PAR_SETTINGS_INDEX_VALID)buildParameterIndex();
+  unsigned int slot=hashParameterName(name,length)%PAR_SETTINGS_INDEX_SIZE;
+  while(PAR_SETTINGS_INDEX[slot]!=0){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[PAR_SETTINGS_INDEX[slot]-1];
+    if(par->matchesName(name,length))return par;
+    slot=(slot+1)%PAR_SETTINGS_INDEX_SIZE;
+  }
+  for(int i=0;i<PAR_SETTINGS_CUR_TABLE_NUMBER;i++){
+    if(PAR_SETTINGS_TABLES[i]->selectEntry(name,length))return PAR_SETTINGS_TABLES[i];
+  }
+  return 0;
+}
+
 ////////////////////
 /// a setting for integer values with optional eeprom persistency
 class IntArduPar: 
@@ -108,7 +657,6 @@ public AbstractArduPar{
 public:
   int value;
   int* valuePointer;   ///< points to the parameter value to be set
-  int eepromAdress;    ///< an adress in eeprom memory for permanent storage of the parameter value. When <0 no storage will happen
   int minValue;        ///< lower Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
   int maxValue;        ///< upper Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
 
@@ -139,25 +687,14 @@ public:
 	#else
 		AbstractArduPar::setup(cmdString);
 	#endif
-	if(isPersistent){
-	
-		if(fixedEEPROMAdress==-1){TRACE((F("Getting EEPROM. Adress: ")));fixedEEPROMAdress=EepromAdressManager::getAdressFor(sizeof(int));};
-		this->eepromAdress=fixedEEPROMAdress;
-		TRACE((F("Init from EEPROM. Adress: ")));
-		TRACE((int)(eepromAdress));
-		eeprom_read_block(valuePointer,(void *) eepromAdress,2); 
-		TRACE((F(" value:")));
-		TRACELN((*valuePointer));
-	}else{
-		this->eepromAdress=-1; // used to signal non-persistence to other methods
-	};	
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	TRACE((F(" value:")));
+	TRACELN((*valuePointer));
   };
 
   //optional osc support
 #ifdef USE_OSC
-  void digestMessage(OSCMessage *_mes){
-    if(!isOscMessageForMe(_mes))return;
-
+  virtual void applyOscMessage(OSCMessage *_mes){
     int newValue;
 	//check argument type.
     if(_mes->getArgTypeTag(0)=='i'){
@@ -177,12 +714,20 @@ public:
 
   ///set the attached integer parameter from a string that was received
   virtual void parseParameterString(char* data){
+    PAR_STAT(if(!isNumberText(data))stats.parseErrors++);
     setValue(atoi(data));
   };
 
+  ///set the attached integer parameter from a binary argument
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->asLong()<minValue||arg->asLong()>maxValue)valueClamped();
+    setValue((int)constrain(arg->asLong(),minValue,maxValue));
+  };
+
   //set the value and rpint some debug info
   void setValue(int newValue){
 	valueReceived=true; // flag: I got new data!
+    if(newValue<minValue||newValue>maxValue)valueClamped();
     newValue=constrain(newValue,minValue,maxValue);
     TRACE((F("Setting ")));
     TRACE((this->cmdString));
@@ -191,14 +736,20 @@ public:
     TRACE((F("\n")));
     *valuePointer=newValue;
     //save the new value
-    if(eepromAdress>=0){
-      TRACE((F("Writing EEProm adress")));
-      TRACE(eepromAdress);
-      TRACE((F("\n")));
-      eeprom_write_block(valuePointer,(void *) eepromAdress,2); 
-
-    }
+    persistValue();
   };
+  virtual void* getValueData(){return valuePointer;}
+  virtual int getValueSize(){return sizeof(*valuePointer);}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='l';arg->intValue=(long)*valuePointer;return true;}
+  virtual bool loadValue(const uint8_t* data){return loadBoundedValue(data,valuePointer,minValue,maxValue);}
+  virtual void valueLoaded(){setValue(*valuePointer);}
+  virtual bool interpolateValue(const void* from, const void* to, uint16_t fraction){
+    int a,b;
+    memcpy(&a,from,sizeof(a));
+    memcpy(&b,to,sizeof(b));
+    *valuePointer=a+(int)(((long)b-a)*fraction/256);
+    return true;
+  }
   /// give human&machine readably status info
   virtual void dumpParameterInfo(Stream* out){
     out->print(F("int\t"));
@@ -239,8 +790,7 @@ public:
 
   //optional osc support
 #ifdef USE_OSC
-  void digestMessage(OSCMessage *_mes){
-    if(!isOscMessageForMe(_mes))return;
+  virtual void applyOscMessage(OSCMessage *_mes){
     TRACE((F("Calling ")));
     TRACE((this->cmdString));
     TRACE((F("\n")));
@@ -255,6 +805,11 @@ public:
     TRACE((F("\n")));
     callbackFunction();
   };
+
+  ///any binary argument triggers the callback
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    parseParameterString(0);
+  };
   /// give human&machine readably status info
   virtual void dumpParameterInfo(Stream* out){
     out->print(F("trigger\t"));
@@ -272,7 +827,6 @@ class StringArduPar:
 public AbstractArduPar{
 public:
   char* valuePointer;   ///< points to the parameter value to be set
-  int eepromAdress;    ///< an adress in eeprom memory for permanent storage of the parameter value. When <0 no storage will happen
   int maxLength;        ///< maximum Length the buffers can hold
 
  /// Initialize the setting. Has to be called for the setting to become usable.
@@ -295,26 +849,15 @@ public:
 	this->valuePointer=valuePointer;
 	this->maxLength=maxLength;
 	//setup reading and writing from eeprom
-	if(isPersistent){
-		//get a generated location for persistency if none was specified
-		if(fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(maxLength);
-		this->eepromAdress=fixedEEPROMAdress;
-		TRACE((F("Init from EEPROM. Adress: ")));
-		TRACE((int)(eepromAdress));
-		eeprom_read_block(valuePointer,(void *) eepromAdress,maxLength);
-		valuePointer[maxLength-1]=0;	//make sure the string is zero terminated even if we read some garbage from eeprom
-		TRACE((F(" value:")));
-		TRACE((valuePointer));
-		TRACE(F("\n"));
-	}else{
-		this->eepromAdress=-1;
-	}
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	if(isPersistent)valuePointer[maxLength-1]=0;	//make sure the string is zero terminated even if we read some garbage from eeprom
+	TRACE((F(" value:")));
+	TRACELN((valuePointer));
   };
 
   //optional osc support
 #ifdef USE_OSC
-  void digestMessage(OSCMessage *_mes){
-     if(!isOscMessageForMe(_mes))return;
+  virtual void applyOscMessage(OSCMessage *_mes){
     if(_mes->getArgTypeTag(0)=='s'){
 	  valueReceived=true; // flag: I got new data!
       char* messageString=_mes->getArgStringData(0);
@@ -332,17 +875,25 @@ public:
   virtual void parseParameterString(char* data){
     int dataLength=strlen(data);
     if(dataLength>1){
-	  valueReceived=true; // flag: I got new data!
       //skip first char.
-      data++;dataLength--;
-      
-      int copyLength=min(maxLength-1,dataLength);
-      strncpy(valuePointer,data,copyLength);
-      valuePointer[copyLength]=0;  //make sure the string is terminated
-      saveValue();
+      setValue(data+1);
     }
   };
 
+  ///set the string parameter from a binary argument. Numbers are ignored.
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='s')setValue(arg->stringValue);
+  };
+
+  ///copy a new value to the buffer, truncating it if necessary, and save it
+  void setValue(const char* newValue){
+    valueReceived=true; // flag: I got new data!
+    int copyLength=min(maxLength-1,(int)strlen(newValue));
+    strncpy(valuePointer,newValue,copyLength);
+    valuePointer[copyLength]=0;  //make sure the string is terminated
+    saveValue();
+  };
+
   //set the value and rpint some debug info
   void saveValue(){
     TRACE((F("Setting ")));
@@ -351,13 +902,21 @@ public:
     TRACE((valuePointer));
     TRACE((F("\n")));
 	//save the new value
-	if(eepromAdress>=0){
-		TRACE((F("Writing EEProm adress")));
-		TRACE(eepromAdress);
-		TRACE((F("\n")));
-		eeprom_write_block(valuePointer,(void *) eepromAdress,maxLength); 
-	}
+	persistValue();
   };
+  virtual void* getValueData(){return valuePointer;}
+  virtual int getValueSize(){return maxLength;}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='s';arg->stringValue=valuePointer;return true;}
+  virtual bool loadValue(const uint8_t* data){
+    if(memchr(data,0,maxLength)==0)return false;	//not terminated, i.e. erased eeprom
+    memcpy(valuePointer,data,maxLength);
+    return true;
+  }
+  virtual void valueLoaded(){
+    valueReceived=true;
+    valuePointer[maxLength-1]=0;  //make sure the string is terminated
+    saveValue();
+  }
   /// give human&machine readably status info
   virtual void dumpParameterInfo(Stream* out){
     out->print(F("string\t"));
@@ -372,43 +931,582 @@ public:
 
 
 
-///this function automatically distributes incoming data from a stream to the parameter setting instances
-void updateParametersFromStream(Stream* inStream, int timeout){
-  if(!inStream->available())return;  //if there is no data available, dont even start timeouts
-  //read data from stream
-  char buf[PAR_SETTINGS_BUFFER_SIZE];
-  int bufPos=0;
-  int inByte;
-  long lastCharMillis=millis();
-  //even if the buffer is full, we keep on reading to flush the remaining data.
-  while((millis()-lastCharMillis)<timeout){
-    inByte=inStream->read();
-    if(inByte>0){
+bool dispatchParameterBatch(char* commands);
+
+/// find the setting a command is meant for and the length of its name. Only arrays accept an index after the name.
+AbstractArduPar* findParameterForCommand(const char* command, int* nameLength){
+  *nameLength=AbstractArduPar::parameterNameLength(command);
+  AbstractArduPar* par=findParameter(command,*nameLength);
+  if(par!=0&&command[*nameLength]=='['&&!par->isArray())return 0;
+  return par;
+}
+
+/// hand a complete command to the parameter setting instance it is meant for. Returns false if there is no such setting.
+/// A command can also be a batch of commands separated by ';', like "kp 1.5;ki 0.2;kd 0". A ';' that is part of a value,
+/// i.e. of a string, is written as "\;".
+/// All commands of a batch are checked before any of them is applied. If one of them is unknown, the whole batch is ignored.
+/// A batch that does not fit PAR_SETTINGS_BUFFER_SIZE never gets here: the stream parser drops the whole line.
+bool dispatchParameterCommand(char* command){
+  if(strchr(command,';')!=0)return dispatchParameterBatch(command);
+  int nameLength;
+  AbstractArduPar* par=findParameterForCommand(command,&nameLength);
+  if(par==0){
+    TRACE((F("Unknown cmd: ")));
+    TRACELN((command));
+    PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+    return false;
+  }
+  PAR_STAT(par->countUpdate());
+  par->receiveString(command+nameLength);
+  return true;
+};
+
+/// Apply a batch of commands separated by ';' as a single update. Returns false and changes nothing if one of the commands is unknown.
+/// The commands are split in place, and "\;" becomes a ';' within a command.
+bool dispatchParameterBatch(char* commands){
+  //first pass: split the commands and make sure that all of them are known
+  char* end=commands;
+  for(char* c=commands;*c!=0;c++){
+    if(*c=='\\'&&c[1]==';')*end++=*++c;
+    else *end++=(*c==';')?0:*c;
+  }
+  *end=0;
+  for(char* c=commands;c<end;c+=strlen(c)+1){
+    while(*c==' ')c++;
+    int nameLength;
+    if(findParameterForCommand(c,&nameLength)==0&&nameLength>0){
+      TRACE((F("Unknown cmd in batch: ")));
+      TRACELN((c));
+      PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+      return false;
+    }
+  }
+  //second pass: apply them
+  beginParameterBatch();
+  for(char* c=commands;c<end;c+=strlen(c)+1){
+    while(*c==' ')c++;
+    int nameLength;
+    AbstractArduPar* par=findParameterForCommand(c,&nameLength);
+    if(par==0)continue;
+    PAR_STAT(par->countUpdate());
+    par->receiveString(c+nameLength);
+  }
+  endParameterBatch();
+  return true;
+}
+
+// Binary frames carry updates for one or more settings without any text parsing or name lookup.
+// They can be mixed with text commands on the same stream, because they are SLIP framed:
+// a frame starts and ends with PAR_FRAME_END, a byte that never occurs in text. Consecutive frames need an PAR_FRAME_END each at start and end.
+// Inside a frame, PAR_FRAME_END is sent as PAR_FRAME_ESC PAR_FRAME_ESC_END and PAR_FRAME_ESC as PAR_FRAME_ESC PAR_FRAME_ESC_ESC.
+// The unescaped frame contains a list of updates and ends with a CRC-8 of everything before it:
+//
+//   [instance number][type tag][payload] [instance number][type tag][payload] ... [crc8]
+//
+// The instance number is the position of the setting in the order of setup() calls, which is also the order of dumpParameterInfos().
+// Payloads are little endian: 'i' 2 bytes, 'l' 4 bytes, 'f' 4 byte float, 's' zero terminated string, 'b' one length byte and that many raw bytes, 't' nothing.
+// Frames longer than PAR_SETTINGS_BUFFER_SIZE bytes are dropped, and so are partial frames after PAR_SETTINGS_FRAME_TIMEOUT ms of silence.
+// Either way the parser goes back to text commands, so a stray PAR_FRAME_END, i.e. line noise at startup, does not swallow them for good.
+// After a frame that was too long, the rest of the line is discarded, because it may be the tail of a text command that is too long.
+#define PAR_FRAME_END 0xC0
+#define PAR_FRAME_ESC 0xDB
+#define PAR_FRAME_ESC_END 0xDC
+#define PAR_FRAME_ESC_ESC 0xDD
+
+// a frame that gets no new byte for this many ms is dropped
+#ifndef PAR_SETTINGS_FRAME_TIMEOUT
+#define PAR_SETTINGS_FRAME_TIMEOUT 50
+#endif
+
+/// CRC-8 with polynomial 0x07
+uint8_t crc8Update(uint8_t crc, const uint8_t* data, int length){
+  while(length-- >0){
+    crc^=*data++;
+    for(uint8_t bit=0;bit<8;bit++)crc=(crc&0x80)?(crc<<1)^0x07:(crc<<1);
+  }
+  return crc;
+}
+
+/// Read one update from a binary frame. Returns the number of bytes it took, or 0 if it is malformed.
+int decodeParameterFrameEntry(const uint8_t* data, int length, uint8_t* instance, ArduParArgument* arg){
+  if(length<2)return 0;
+  *instance=data[0];
+  arg->typeTag=data[1];
+  data+=2;length-=2;
+  switch(arg->typeTag){
+    case 'i':
+      if(length<2)return 0;
+      arg->intValue=(int16_t)(data[0]|((uint16_t)data[1]<<8));
+      return 4;
+    case 'l':
+      if(length<4)return 0;
+      arg->intValue=(int32_t)(data[0]|((uint32_t)data[1]<<8)|((uint32_t)data[2]<<16)|((uint32_t)data[3]<<24));
+      return 6;
+    case 'f':
+      if(length<4)return 0;
+      memcpy(&arg->floatValue,data,4);
+      return 6;
+    case 's':{
+      const uint8_t* end=(const uint8_t*)memchr(data,0,length);
+      if(end==0)return 0;
+      arg->stringValue=(const char*)data;
+      return 2+(end-data)+1;
+    }
+    case 'b':
+      if(length<1||length<1+data[0])return 0;
+      arg->intValue=data[0];
+      arg->stringValue=(const char*)data+1;
+      return 3+data[0];
+    case 't':
+      return 2;
+  }
+  return 0;
+}
+
+/// Apply the updates in an unescaped binary frame as one batch. The whole frame is checked before anything is applied.
+/// Returns the number of updates, or -1 if the frame was rejected.
+int dispatchParameterFrame(const uint8_t* frame, int length){
+  if(length<1||crc8Update(0,frame,length-1)!=frame[length-1]){
+    TRACELN((F("Bad frame crc")));
+    PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+    return -1;
+  }
+  length--;
+  uint8_t instance;
+  ArduParArgument arg;
+  int pos=0;
+  while(pos<length){
+    int entryLength=decodeParameterFrameEntry(frame+pos,length-pos,&instance,&arg);
+    if(entryLength==0||instance>=PAR_SETTINGS_CUR_INSTANCE_NUMBER){
+      TRACELN((F("Bad frame")));
+      PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+      return -1;
+    }
+    pos+=entryLength;
+  }
+  int updates=0;
+  beginParameterBatch();
+  for(pos=0;pos<length;updates++){
+    pos+=decodeParameterFrameEntry(frame+pos,length-pos,&instance,&arg);
+    PAR_STAT(PAR_SETTINGS_INSTANCES[instance]->countUpdate());
+    PAR_SETTINGS_INSTANCES[instance]->receiveArgument(&arg);
+  }
+  endParameterBatch();
+  return updates;
+}
+
+////////////////////
+/// Collects commands from a Stream without ever waiting for data.
+/// Only bytes that are already available are consumed. A command ends with a line break, incomplete lines are kept until the next call.
+/// Binary frames (see dispatchParameterFrame()) can be mixed with the text commands.
+/// Every stream needs its own parser, so that partial commands of different streams do not get mixed.
+class ArduParStreamParser{
+public:
+  Stream* stream;                         ///< commands are read from this stream
+  int timeout;                            ///< an unterminated command is dispatched after this many ms without new data. Use -1 to wait for a line break forever.
+  char buffer[PAR_SETTINGS_BUFFER_SIZE];  ///< holds the command that is currently received
+  int bufPos;                             ///< number of chars in the buffer
+  unsigned long lastCharMillis;           ///< time when the last char was received
+  bool inFrame;                           ///< a binary frame is being received
+  bool frameEscape;                       ///< the last byte of the frame was PAR_FRAME_ESC
+  bool overflow;                          ///< the text command did not fit the buffer and is discarded when its line ends
+
+  ArduParStreamParser(
+    Stream* stream=0,	///< the stream to read from. can also be given in setup()
+    int timeout=-1		///< dispatch unterminated commands after this many ms of silence. -1 waits for a line break.
+  ):
+  stream(stream),
+  timeout(timeout),
+  bufPos(0),
+  lastCharMillis(0),
+  inFrame(false),
+  frameEscape(false),
+  overflow(false)
+  {
+  }
+
+  /// set the stream to read from and discard any partially received command.
+  void setup(Stream* stream, int timeout=-1){
+    this->stream=stream;
+    this->timeout=timeout;
+    bufPos=0;
+    inFrame=false;
+    overflow=false;
+  }
+
+  /// Consume all bytes that are available right now, or no more than "maxBytes", and dispatch every command that was completed.
+  /// Returns the number of commands that were dispatched. Never blocks.
+  int update(int maxBytes=-1){
+    int dispatched=0;
+    if(stream==0)return 0;
+    int pending=stream->available();
+    if(maxBytes>=0&&pending>maxBytes)pending=maxBytes;
+    while(pending-- >0){
+      int inByte=stream->read();
+      if(inByte<0)continue;
+      if(inFrame&&millis()-lastCharMillis>=PAR_SETTINGS_FRAME_TIMEOUT)dropFrame();	//the sender gave up on it, or it was no frame at all
       lastCharMillis=millis();
-      if(bufPos<PAR_SETTINGS_BUFFER_SIZE-1){
-        buf[bufPos]=inByte;
-        bufPos++;
+      if(inByte==PAR_FRAME_END){
+        if(inFrame&&bufPos>0){
+          if(dispatchParameterFrame((uint8_t*)buffer,bufPos)>=0)dispatched++;
+          inFrame=false;
+        }else{
+          inFrame=true;   //a partial text command is dropped
+        }
+        bufPos=0;
+        frameEscape=false;
+        overflow=false;
+      }else if(inFrame){
+        if(frameEscape){
+          if(inByte==PAR_FRAME_ESC_END)inByte=PAR_FRAME_END;
+          if(inByte==PAR_FRAME_ESC_ESC)inByte=PAR_FRAME_ESC;
+          frameEscape=false;
+        }else if(inByte==PAR_FRAME_ESC){
+          frameEscape=true;
+          continue;
+        }
+        //frames do not need a terminating zero, so they can use the whole buffer. Longer ones are dropped. They may have been text
+        //after a stray PAR_FRAME_END, so the rest of the line is discarded like a text command that is too long.
+        if(bufPos<PAR_SETTINGS_BUFFER_SIZE)buffer[bufPos++]=inByte;
+        else{
+          dropFrame();
+          overflow=true;
+        }
+      }else if(inByte==0){
+        continue;
+      }else if(inByte=='\n'||inByte=='\r'){
+        if(finishCommand())dispatched++;
+      }else{
+        //a command that does not fit the buffer is discarded as a whole when its line ends, so no part of it is applied
+        if(bufPos<PAR_SETTINGS_BUFFER_SIZE-1){
+          buffer[bufPos]=inByte;
+          bufPos++;
+        }else overflow=true;
+      }
+    }
+    //finish commands that were sent without a line break once the sender has gone quiet
+    if(bufPos>0&&!inFrame&&timeout>=0&&(millis()-lastCharMillis)>=(unsigned long)timeout){
+      if(finishCommand())dispatched++;
+    }
+    return dispatched;
+  }
+
+  /// discard a partial binary frame and go back to text commands
+  void dropFrame(){
+    TRACELN((F("Frame dropped")));
+    PAR_STAT(if(bufPos>0)PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+    inFrame=false;
+    frameEscape=false;
+    bufPos=0;
+  }
+
+  /// dispatch whatever is in the buffer and start over. Returns false if the buffer was empty or the command was too long.
+  bool finishCommand(){
+    if(bufPos==0){
+      overflow=false;
+      return false;
+    }
+    buffer[bufPos]=0;
+    bufPos=0;
+    if(overflow){
+      overflow=false;
+      TRACE((F("Cmd too long: ")));
+      TRACELN((buffer));
+      PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+      return false;
+    }
+    TRACE((F("Received cmd: ")));
+    TRACELN((buffer));
+    dispatchParameterCommand(buffer);
+    return true;
+  }
+};
+
+// updateParametersFromStream() keeps a parser for each stream it is called with. You can change the maximum number of streams here.
+#ifndef PAR_SETTINGS_MAX_STREAMS
+#define PAR_SETTINGS_MAX_STREAMS 1
+#endif
+ArduParStreamParser PAR_SETTINGS_STREAM_PARSERS[PAR_SETTINGS_MAX_STREAMS];
+
+/// Find the parser that belongs to "inStream", or take a free one for it. Returns 0 if all of them are taken.
+/// Streams that were added are also read by serviceParameters().
+ArduParStreamParser* addParameterStream(Stream* inStream, int timeout){
+  ArduParStreamParser* parser=0;
+  for(int i=0;i<PAR_SETTINGS_MAX_STREAMS&&parser==0;i++){
+    if(PAR_SETTINGS_STREAM_PARSERS[i].stream==inStream)parser=&PAR_SETTINGS_STREAM_PARSERS[i];
+  }
+  for(int i=0;i<PAR_SETTINGS_MAX_STREAMS&&parser==0;i++){
+    if(PAR_SETTINGS_STREAM_PARSERS[i].stream==0){
+      parser=&PAR_SETTINGS_STREAM_PARSERS[i];
+      parser->setup(inStream,timeout);
+    }
+  }
+  if(parser==0){
+    Serial.println(F("Max streams exceeded, could not read commands"));
+    return 0;
+  }
+  parser->timeout=timeout;
+  return parser;
+}
+
+///this function automatically distributes incoming data from a stream to the parameter setting instances.
+///It only processes data that is already available and returns immediately. Commands are terminated by a line break,
+///or by a pause of "timeout" milliseconds if the sender does not send line breaks (like the Arduino Serial Monitor set to "No line ending").
+void updateParametersFromStream(Stream* inStream, int timeout){
+#if PAR_SETTINGS_STATS
+  unsigned long start=micros();
+#endif
+  ArduParStreamParser* parser=addParameterStream(inStream,timeout);
+  if(parser==0)return;
+  parser->update();
+  PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.parseMicros+=micros()-start);
+};
+
+/// true for OSC adresses that contain pattern characters
+bool isOscPattern(const char* adress){
+  return strpbrk(adress,"*?[{")!=0;
+}
+
+/// Match an OSC 1.0 adress pattern against an adress in program memory.
+/// Understands "?", "*", "[abc]", "[a-z]", "[!a-z]" and "{foo,bar}". "?", "*" and "[]" do not match "/".
+bool matchOscPattern(const char* pattern, const char PROGMEM * adress){
+  for(;;){
+    char a=pgm_read_byte(adress);
+    switch(*pattern){
+      case 0:
+        return a==0;
+      case '?':
+        if(a==0||a=='/')return false;
+        break;
+      case '*':
+        while(*pattern=='*')pattern++;
+        //try all lengths up to the end of the adress part
+        for(;;){
+          if(matchOscPattern(pattern,adress))return true;
+          a=pgm_read_byte(adress);
+          if(a==0||a=='/')return false;
+          adress++;
+        }
+      case '[':{
+        if(a==0||a=='/')return false;
+        pattern++;
+        bool negate=(*pattern=='!');
+        if(negate)pattern++;
+        bool found=false;
+        while(*pattern!=']'){
+          if(*pattern==0)return false;
+          char low=*pattern++;
+          char high=low;
+          if(*pattern=='-'&&pattern[1]!=']'&&pattern[1]!=0){
+            high=pattern[1];
+            pattern+=2;
+          }
+          if(a>=low&&a<=high)found=true;
+        }
+        if(found==negate)return false;
+        break;
+      }
+      case '{':{
+        const char* end=strchr(pattern,'}');
+        if(end==0)return false;
+        //try each alternative, followed by the rest of the pattern
+        const char* alternative=pattern+1;
+        while(alternative<=end){
+          const char* alternativeEnd=alternative;
+          while(alternativeEnd<end&&*alternativeEnd!=',')alternativeEnd++;
+          int length=alternativeEnd-alternative;
+          if(strncmp_P(alternative,adress,length)==0&&matchOscPattern(end+1,adress+length))return true;
+          alternative=alternativeEnd+1;
+        }
+        return false;
       }
+      default:
+        if(*pattern!=a)return false;
     }
+    pattern++;
+    adress++;
   }
+}
 
-  buf[bufPos]=0;
+#ifdef USE_OSC
+/// convert an argument of an OSC message. Returns false for argument types that settings do not understand.
+bool getOscArgument(OSCMessage* mes, int index, ArduParArgument* arg){
+  arg->typeTag=mes->getArgTypeTag(index);
+  switch(arg->typeTag){
+    case 'i':
+      arg->typeTag='l';
+      arg->intValue=mes->getArgInt32(index);
+      return true;
+    case 'f':
+      arg->floatValue=mes->getArgFloat(index);
+      return true;
+    case 's':
+      arg->stringValue=mes->getArgStringData(index);
+      return true;
+  }
+  return false;
+}
+
+////////////////////
+/// The only OSC message sink the settings need. Exact adresses are looked up in the same index as serial commands.
+/// Adress patterns like "/mixer/ch[1-4]/gain" set every setting that matches, in one batch.
+/// Settings that were set up with an OSCServer register the router with it, so there is nothing to set up by hand.
+class ArduParOscRouter: public OscMessageSink{
+public:
+  OSCServer* servers[2];   ///< servers the router was added to
 
-  //let all the parameter setting instances have a look at the data
-  if(bufPos>0){
+  /// make sure the router receives the messages of "server"
+  void addServer(OSCServer* server){
+    for(int i=0;i<2;i++){
+      if(servers[i]==server)return;
+      if(servers[i]==0){
+        servers[i]=server;
+        server->addOscMessageSink(this);
+        return;
+      }
+    }
+    Serial.println(F("Max OSC servers exceeded"));
+  }
+
+  void digestMessage(OSCMessage *_mes){
+    const char* adress=_mes->getOSCAddress();
+    if(!isOscPattern(adress)){
+      AbstractArduPar* par=findParameter(adress,strlen(adress));
+      if(par==0||!par->oscEnabled){
+        PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+        return;
+      }
+      PAR_STAT(par->countUpdate());
+      par->receiveOscMessage(_mes);
+      return;
+    }
+    beginParameterBatch();
     for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
-      PAR_SETTINGS_INSTANCES[i]->parseSerialData(buf);
-    } 
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!par->oscEnabled||!matchOscPattern(adress,(const char PROGMEM *)par->cmdString))continue;
+      PAR_STAT(par->countUpdate());
+      par->receiveOscMessage(_mes);
+    }
+    endParameterBatch();
   }
 };
+ArduParOscRouter PAR_SETTINGS_OSC_ROUTER;
+
+void addParameterOscServer(OSCServer* server){
+  PAR_SETTINGS_OSC_ROUTER.addServer(server);
+}
+
+////////////////////
+/// Receives OSC messages that set several settings at once. Their arguments are pairs of a setting name and a value,
+/// i.e. "/batch ,sfsfsi kp 1.5 ki 0.2 max 255". All pairs are checked before any of them is applied, like a batch of serial commands.
+class ArduParOscBatchSink: public OscMessageSink{
+public:
+  const __FlashStringHelper* adress;   ///< OSC adress of the batch messages
+
+  /// start receiving batches at the given adress
+  void setup(const __FlashStringHelper* adress, OSCServer *server=globalArduParOscServer){
+    this->adress=adress;
+    server->addOscMessageSink(this);
+  }
+
+  void digestMessage(OSCMessage *_mes){
+    if(strcmp_P(_mes->getOSCAddress(),(const char PROGMEM *)adress)!=0)return;
+    int numArgs=_mes->getArgsNum();
+    if(numArgs%2!=0)return;
+    ArduParArgument arg;
+    for(int i=0;i<numArgs;i+=2){
+      if(_mes->getArgTypeTag(i)!='s'||!getOscArgument(_mes,i+1,&arg))return;
+      const char* name=_mes->getArgStringData(i);
+      if(findParameter(name,strlen(name))==0)return;
+    }
+    beginParameterBatch();
+    for(int i=0;i<numArgs;i+=2){
+      const char* name=_mes->getArgStringData(i);
+      getOscArgument(_mes,i+1,&arg);
+      AbstractArduPar* par=findParameter(name,strlen(name));
+      PAR_STAT(par->countUpdate());
+      par->receiveArgument(&arg);
+    }
+    endParameterBatch();
+  }
+};
+#endif
+
+//dump output is collected in a buffer of this size and written one line at a time. Longer lines are written in pieces.
+#ifndef PAR_SETTINGS_DUMP_BUFFER_SIZE
+#define PAR_SETTINGS_DUMP_BUFFER_SIZE PAR_SETTINGS_BUFFER_SIZE
+#endif
+
+/// Collects what the dumpParameterInfo() methods print and passes it on with one write() per line,
+/// instead of one write for every field and every char of a flash string.
+class ArduParLineBuffer:
+public Stream{
+public:
+  Stream* target;
+  uint8_t buffer[PAR_SETTINGS_DUMP_BUFFER_SIZE];
+  int length;
+
+  ArduParLineBuffer(Stream* target):target(target),length(0){}
+  ~ArduParLineBuffer(){flush();}
+
+  virtual size_t write(uint8_t c){
+    buffer[length++]=c;
+    if(c=='\n'||length==PAR_SETTINGS_DUMP_BUFFER_SIZE)flush();
+    return 1;
+  }
+  using Print::write;
+  /// write what was collected so far
+  virtual void flush(){
+    if(length>0)target->write(buffer,length);
+    length=0;
+  }
+  //nothing to read
+  virtual int available(){return 0;}
+  virtual int read(){return -1;}
+  virtual int peek(){return -1;}
+};
 
 /// write information about all parameter instances to a stream
 void dumpParameterInfos(Stream* outStream){
+  ArduParLineBuffer lines(outStream);
   for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
-    PAR_SETTINGS_INSTANCES[i]->dumpParameterInfo(outStream);
+    PAR_SETTINGS_INSTANCES[i]->dumpParameterInfo(&lines);
   } 
 };
 
+/// Write information about "count" parameter instances, starting with instance number "first".
+/// Returns the number of the next instance to dump, which equals PAR_SETTINGS_CUR_INSTANCE_NUMBER when all were written.
+/// Lets a host sync a few settings per loop() instead of blocking until all are sent:
+///   nextPage=dumpParameterInfos(&Serial,nextPage,4); if(nextPage>=PAR_SETTINGS_CUR_INSTANCE_NUMBER) ...
+int dumpParameterInfos(Stream* outStream, int first, int count){
+  ArduParLineBuffer lines(outStream);
+  int i=max(first,0);
+  for(;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER&&count>0;i++,count--){
+    PAR_SETTINGS_INSTANCES[i]->dumpParameterInfo(&lines);
+  }
+  return i;
+}
+
+uint16_t PAR_SETTINGS_LAST_DUMP_SEQUENCE=0;	///< change sequence at the last dumpChangedParameterInfos()
+
+/// Write information about the parameter instances that changed after the change sequence number "since".
+/// Returns the current sequence number. Pass it in the next time to get only what changed in between.
+/// Sequence numbers wrap around after 65535 changes. Settings that were not touched for more than 32767 changes may be sent again.
+uint16_t dumpChangedParameterInfos(Stream* outStream, uint16_t since){
+  ArduParLineBuffer lines(outStream);
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    if(par->changeSequence!=0&&(int16_t)(par->changeSequence-since)>0)par->dumpParameterInfo(&lines);
+  }
+  PAR_SETTINGS_LAST_DUMP_SEQUENCE=PAR_SETTINGS_CHANGE_SEQUENCE;
+  return PAR_SETTINGS_CHANGE_SEQUENCE;
+}
+
+/// Write information about the parameter instances that changed since the last call of dumpChangedParameterInfos().
+uint16_t dumpChangedParameterInfos(Stream* outStream){
+  return dumpChangedParameterInfos(outStream,PAR_SETTINGS_LAST_DUMP_SEQUENCE);
+}
+
 /// write information about all parameter instances to a stream
 void dumpParameterInfos(){
   dumpParameterInfos(&Serial);
@@ -422,7 +1520,6 @@ public AbstractArduPar{
 public:
   long value;			///< will hold the value if no valuePointer was specified in setup
   long* valuePointer;   ///< points to the parameter value to be set
-  int eepromAdress;    ///< an adress in eeprom memory for permanent storage of the parameter value. When <0 no storage will happen
   long minValue;        ///< lower Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
   long maxValue;        ///< upper Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
 
@@ -446,23 +1543,14 @@ public:
 	#else
 		AbstractArduPar::setup(cmdString);
 	#endif
-	if(isPersistent){
-		if(fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(sizeof(long));
-		this->eepromAdress=fixedEEPROMAdress;
-		TRACE((F("Init from EEPROM. Adress: ")));
-		TRACE((int)(eepromAdress));
-		eeprom_read_block(valuePointer,(void *) eepromAdress,4); 
-		TRACE((F(" value:")));
-		TRACELN((*valuePointer));
-	}else{
-		this->eepromAdress=-1; // used to signal non-persistence to other methods
-	};	
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	TRACE((F(" value:")));
+	TRACELN((*valuePointer));
   };
 
   //optional osc support
 #ifdef USE_OSC
-  void digestMessage(OSCMessage *_mes){
-    if(!isOscMessageForMe(_mes))return;
+  virtual void applyOscMessage(OSCMessage *_mes){
     long newValue;
     if(_mes->getArgTypeTag(0)=='i'){
       newValue =  _mes->getArgInt32(0);
@@ -481,13 +1569,20 @@ public:
 
   ///set the attached integer parameter from a string that was received
   virtual void parseParameterString(char* data){
+    PAR_STAT(if(!isNumberText(data))stats.parseErrors++);
     long newValue=atol(data);
     setValue(newValue);
   };
 
+  ///set the attached integer parameter from a binary argument
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    setValue(arg->asLong());
+  };
+
   //set the value and rpint some debug info
   void setValue(long newValue){
 	  valueReceived=true; // flag: I got new data!
+	if(newValue<minValue||newValue>maxValue)valueClamped();
 	newValue=constrain(newValue,minValue,maxValue);
     TRACE((F("Setting ")));
     TRACE((this->cmdString));
@@ -496,14 +1591,21 @@ public:
     TRACE((F("\n")));
     *valuePointer=newValue;
     //save the new value
-    if(eepromAdress>=0){
-      TRACE((F("Writing EEProm adress")));
-      TRACE(eepromAdress);
-      TRACE((F("\n")));
-      eeprom_write_block(valuePointer,(void *) eepromAdress,4); 
-
-    }
+    persistValue();
   };
+  virtual void* getValueData(){return valuePointer;}
+  virtual int getValueSize(){return sizeof(*valuePointer);}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='l';arg->intValue=*valuePointer;return true;}
+  virtual bool loadValue(const uint8_t* data){return loadBoundedValue(data,valuePointer,minValue,maxValue);}
+  virtual void valueLoaded(){setValue(*valuePointer);}
+  virtual bool interpolateValue(const void* from, const void* to, uint16_t fraction){
+    long a,b;
+    memcpy(&a,from,sizeof(a));
+    memcpy(&b,to,sizeof(b));
+    long difference=b-a;
+    *valuePointer=a+(difference/256)*fraction+(difference%256)*(long)fraction/256;	//difference*fraction might not fit into a long
+    return true;
+  }
   /// give human&machine readably status info
   virtual void dumpParameterInfo(Stream* out=&Serial){
     out->print(F("int\t"));
@@ -527,7 +1629,6 @@ public AbstractArduPar{
 public:
   float value;
   float* valuePointer;   ///< points to the parameter value to be set
-  int eepromAdress;    ///< an adress in eeprom memory for permanent storage of the parameter value. When <0 no storage will happen
   float minValue;        ///< lower Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
   float maxValue;        ///< upper Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
 
@@ -558,24 +1659,14 @@ public:
 	#else
 		AbstractArduPar::setup(cmdString);
 	#endif
-	if(isPersistent){
-	
-		if(fixedEEPROMAdress==-1){TRACE((F("Getting EEPROM. Adress: ")));fixedEEPROMAdress=EepromAdressManager::getAdressFor(sizeof(float));};
-		this->eepromAdress=fixedEEPROMAdress;
-		TRACE((F("Init from EEPROM. Adress: ")));
-		TRACE((int)(eepromAdress));
-		eeprom_read_block(valuePointer,(void *) eepromAdress,sizeof(float)); 
-		TRACE((F(" value:")));
-		TRACELN((*valuePointer));
-	}else{
-		this->eepromAdress=-1; // used to signal non-persistence to other methods
-	};	
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	TRACE((F(" value:")));
+	TRACELN((*valuePointer));
   };
 
   //optional osc support
 #ifdef USE_OSC
-  void digestMessage(OSCMessage *_mes){
-    if(!isOscMessageForMe(_mes))return;
+  virtual void applyOscMessage(OSCMessage *_mes){
     float newValue;
     if(_mes->getArgTypeTag(0)=='i'){
       newValue =  (float)_mes->getArgInt32(0);
@@ -594,12 +1685,19 @@ public:
 
   ///set the attached integer parameter from a string that was received
   virtual void parseParameterString(char* data){
+    PAR_STAT(if(!isNumberText(data))stats.parseErrors++);
     setValue(atof(data));
   };
 
+  ///set the attached float parameter from a binary argument
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    setValue(arg->asFloat());
+  };
+
   //set the value and rpint some debug info
   void setValue(float newValue){
 	valueReceived=true; // flag: I got new data!
+    if(newValue<minValue||newValue>maxValue)valueClamped();
     newValue=constrain(newValue,minValue,maxValue);
     TRACE((F("Setting ")));
     TRACE((this->cmdString));
@@ -608,14 +1706,20 @@ public:
     TRACE((F("\n")));
     *valuePointer=newValue;
     //save the new value
-    if(eepromAdress>=0){
-      TRACE((F("Writing EEProm adress")));
-      TRACE(eepromAdress);
-      TRACE((F("\n")));
-      eeprom_write_block(valuePointer,(void *) eepromAdress,sizeof(float)); 
-
-    }
+    persistValue();
   };
+  virtual void* getValueData(){return valuePointer;}
+  virtual int getValueSize(){return sizeof(*valuePointer);}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='f';arg->floatValue=*valuePointer;return true;}
+  virtual bool loadValue(const uint8_t* data){return loadBoundedValue(data,valuePointer,minValue,maxValue);}
+  virtual void valueLoaded(){setValue(*valuePointer);}
+  virtual bool interpolateValue(const void* from, const void* to, uint16_t fraction){
+    float a,b;
+    memcpy(&a,from,sizeof(a));
+    memcpy(&b,to,sizeof(b));
+    *valuePointer=a+(b-a)*(fraction/256.0f);
+    return true;
+  }
   /// give human&machine readably status info
   virtual void dumpParameterInfo(Stream* out){
     out->print(F("float\t"));
@@ -632,6 +1736,17 @@ public:
   } 
 };
 
-
-
-
+#include "TableArduPar.h"
+#include "ArrayArduPar.h"
+#include "FixedArduPar.h"
+#include "ArduParOscScheduler.h"
+#include "ArduParFeedback.h"
+#include "ArduParPresets.h"
+#include "ArduParStats.h"
+#include "ArduParImage.h"
+#include "ArduParPublished.h"
+#include "BitFieldArduPar.h"
+#include "CurveArduPar.h"
+#include "DerivedArduPar.h"
+#include "ArenaStringArduPar.h"
+#include "ArduParService.h"
@@ -0,0 +1,156 @@
+#pragma once
+// Sends changed values back to a host. Included by ArduPar.h.
+//
+// When the firmware changes a setting with setValue(), or a received value is constrained to its bounds,
+// a GUI only learns the new value from the next dump. An ArduParFeedbackPublisher sends values that changed,
+// either as command lines ("speed 100\n") to a Stream or as OSC messages handed to a function that sends a packet.
+//
+// Changes are not sent when they happen, but by update(), which you call in loop(). Each call looks at most once per
+// "interval" for changes and sends each changed setting once, with its latest value.
+// Values that were received from a host and taken as they were are not sent, because the host knows them already.
+// So a fader storm is not echoed, but if it pushes a setting past its bounds, the clamped value goes back once per interval.
+// Sending is also limited to "bytesPerSecond". What does not fit is sent by the next calls.
+//
+// Example:
+//   ArduParFeedbackPublisher feedback;
+//   feedback.setup(&Serial,50,1000);   //at most every 50ms, 1000 bytes/s
+//   ...
+//   feedback.update();
+
+// digits after the point for float values in feedback lines
+#ifndef PAR_FEEDBACK_FLOAT_DIGITS
+#define PAR_FEEDBACK_FLOAT_DIGITS 3
+#endif
+
+/// write a 32 bit number big endian, as used by OSC
+void writeOscInt32(uint8_t* data, uint32_t value){
+  data[0]=value>>24;
+  data[1]=value>>16;
+  data[2]=value>>8;
+  data[3]=value;
+}
+
+/// Encode an OSC message with the adress of "par" and its value as the only argument. Returns the length, 0 if it does not fit into "size" bytes.
+int encodeOscValueMessage(AbstractArduPar* par, ArduParArgument* arg, uint8_t* buffer, int size){
+  int adressLength=par->cmdStringLength;
+  int pos=(adressLength/4+1)*4;
+  int argLength=arg->typeTag=='s'?(strlen(arg->stringValue)/4+1)*4:4;
+  if(pos+4+argLength>size)return 0;
+  memset(buffer,0,pos+4+argLength);
+  memcpy_P(buffer,(const char PROGMEM *)par->cmdString,adressLength);
+  buffer[pos]=',';
+  buffer[pos+1]=arg->typeTag=='l'?'i':arg->typeTag;
+  pos+=4;
+  if(arg->typeTag=='s'){
+    memcpy(buffer+pos,arg->stringValue,strlen(arg->stringValue));
+  }else if(arg->typeTag=='f'){
+    uint32_t bits;
+    memcpy(&bits,&arg->floatValue,4);
+    writeOscInt32(buffer+pos,bits);
+  }else{
+    writeOscInt32(buffer+pos,(uint32_t)arg->intValue);
+  }
+  return pos+argLength;
+}
+
+/// Write "name value\n" into "buffer", so it can be sent back as a command. Returns the length, 0 if it does not fit into "size" bytes.
+int formatValueLine(AbstractArduPar* par, ArduParArgument* arg, char* buffer, int size){
+  char value[24];
+  const char* valueText=value;
+  if(arg->typeTag=='s')valueText=arg->stringValue;
+  else if(arg->typeTag=='f')dtostrf(arg->floatValue,1,PAR_FEEDBACK_FLOAT_DIGITS,value);
+  else{
+    value[0]='-';
+    ultoa(arg->intValue<0?-(unsigned long)arg->intValue:(unsigned long)arg->intValue,value+(arg->intValue<0),10);
+  }
+  int valueLength=strlen(valueText);
+  int length=par->cmdStringLength+1+valueLength+1;
+  if(length>size)return 0;
+  memcpy_P(buffer,(const char PROGMEM *)par->cmdString,par->cmdStringLength);
+  buffer[par->cmdStringLength]=' ';
+  memcpy(buffer+par->cmdStringLength+1,valueText,valueLength);
+  buffer[length-1]='\n';
+  return length;
+}
+
+////////////////////
+/// Sends values that changed back to a host, coalesced and rate limited. Uses the change sequence numbers, so it costs nothing while values are received.
+class ArduParFeedbackPublisher{
+public:
+  Stream* stream;								///< command lines go here, if set
+  void (*sendPacket)(const uint8_t* data, int size);	///< OSC messages are given to this function, if set
+  unsigned long interval;						///< minimum time in ms between two looks for changes
+  unsigned long bytesPerSecond;					///< long term limit for the output
+  long budget;									///< bytes that may be sent right now
+  unsigned long lastRefillMillis;
+  unsigned long lastPassMillis;
+  uint16_t publishedSequence;					///< changes up to this sequence number were sent
+  uint16_t passSequence;						///< sequence number when the current pass started
+  int cursor;									///< next instance to look at, -1 if no pass is running
+
+  /// send changes as command lines to "stream"
+  void setup(Stream* stream, unsigned long interval=50, unsigned long bytesPerSecond=1000){
+    this->stream=stream;
+    this->sendPacket=0;
+    begin(interval,bytesPerSecond);
+  }
+
+  /// send changes as OSC messages, each given to "sendPacket", i.e. to send it as a UDP packet
+  void setup(void (*sendPacket)(const uint8_t* data, int size), unsigned long interval=50, unsigned long bytesPerSecond=1000){
+    this->stream=0;
+    this->sendPacket=sendPacket;
+    begin(interval,bytesPerSecond);
+  }
+
+  /// Send what changed, as far as interval and budget allow. Call this regularly in loop(). Returns the number of bytes sent.
+  int update(){
+    unsigned long now=millis();
+    refill(now);
+    if(cursor<0){
+      if(PAR_SETTINGS_CHANGE_SEQUENCE==publishedSequence||now-lastPassMillis<interval)return 0;
+      lastPassMillis=now;
+      passSequence=PAR_SETTINGS_CHANGE_SEQUENCE;
+      cursor=0;
+    }
+    int sent=0;
+    uint8_t buffer[PAR_SETTINGS_BUFFER_SIZE];
+    for(;cursor<PAR_SETTINGS_CUR_INSTANCE_NUMBER;cursor++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[cursor];
+      if(par->changeSequence==0||(int16_t)(par->changeSequence-publishedSequence)<=0||par->changeReceived)continue;
+      ArduParArgument arg;
+      if(!par->getValueArgument(&arg))continue;
+      int length=sendPacket!=0?encodeOscValueMessage(par,&arg,buffer,sizeof(buffer)):formatValueLine(par,&arg,(char*)buffer,sizeof(buffer));
+      if(length==0)continue;	//too long to send
+      if(length>budget)return sent;	//continue here next time
+      if(sendPacket!=0)sendPacket(buffer,length);
+      else stream->write(buffer,length);
+      budget-=length;
+      sent+=length;
+    }
+    //settings that changed during the pass were either sent with their new value or come again in the next pass
+    publishedSequence=passSequence;
+    cursor=-1;
+    return sent;
+  }
+
+private:
+  void begin(unsigned long interval, unsigned long bytesPerSecond){
+    this->interval=interval;
+    this->bytesPerSecond=bytesPerSecond;
+    budget=maxBudget();
+    lastRefillMillis=millis();
+    lastPassMillis=lastRefillMillis-interval;
+    publishedSequence=PAR_SETTINGS_CHANGE_SEQUENCE;	//values that were set before are not sent
+    cursor=-1;
+  }
+  /// the budget can grow to a tenth of a second's worth, but at least one message
+  long maxBudget(){return max((long)(bytesPerSecond/10),(long)PAR_SETTINGS_BUFFER_SIZE);}
+  void refill(unsigned long now){
+    unsigned long elapsed=min(now-lastRefillMillis,1000UL);
+    long added=(long)(elapsed*bytesPerSecond/1000);
+    if(added==0)return;	//wait until at least one byte was earned
+    lastRefillMillis=now;
+    budget+=added;
+    if(budget>maxBudget())budget=maxBudget();
+  }
+};
@@ -0,0 +1,127 @@
+#pragma once
+// Validated loading of all persistent settings at once. Included by ArduPar.h.
+//
+// Normally, every setup() reads its value from eeprom right away and takes whatever it finds there, which is 0xFF garbage
+// on a new chip or after the settings of a sketch changed. Settings that are set up between beginParameterImage() and
+// loadParameterImage() keep their defaults in setup() instead. loadParameterImage() reads their eeprom block in one go and checks it:
+//
+//   [layout hash (2 bytes)][crc16 of the values (2 bytes)][values of all settings in the order of their setup()]
+//
+// The layout hash covers the names and sizes of the settings. If it or the crc does not match, all settings keep their defaults,
+// the values they had before setup(), and the image is written anew with them. Otherwise each value is checked against the bounds
+// of its setting, and values out of bounds are replaced by the default. Like received values, loaded values queue change notifications
+// and mark the values derived from them dirty, so derived values that were computed from the defaults in setup() are computed again.
+// The crc is only written after values of the image were written, not for settings outside of it: right after the value if persistence
+// is immediate, and once per commitParameters(), flushParameters() or commit of serviceParameters() if it is deferred, so a commit
+// that writes several values writes the crc once. A power loss in between makes the next start fall back to the defaults.
+//
+// Only settings that get their eeprom adress from the EepromAdressManager are part of the image, not the ones with a fixed adress
+// or in the parameter log. Preset banks have to be set up after loadParameterImage(), because they are not part of it.
+//
+// Example:
+//   beginParameterImage();
+//   speedSetting.setup(F("speed"),0,100);   //speedSetting.value keeps its default for now
+//   ...
+//   loadParameterImage();
+
+// RAM on the stack for reading the image. An image that fits is read at once, otherwise each value is read by itself.
+// No setting can store more than this.
+#ifndef PAR_SETTINGS_IMAGE_STAGING_SIZE
+#define PAR_SETTINGS_IMAGE_STAGING_SIZE 128
+#endif
+
+#define PAR_IMAGE_HEADER_SIZE 4	///< layout hash and crc
+
+/// Start an image. Settings that are set up from now on are loaded by loadParameterImage().
+void beginParameterImage(){
+  PAR_SETTINGS_IMAGE_ADRESS=EepromAdressManager::getAdressFor(PAR_IMAGE_HEADER_SIZE);
+  PAR_SETTINGS_IMAGE_END=-1;
+}
+
+/// true if "par" stores its value in the image
+bool isInParameterImage(AbstractArduPar* par){
+  int adress=par->getStorageAdress();
+  return par->getStorageSize()>0&&adress>PAR_SETTINGS_IMAGE_ADRESS&&adress<PAR_SETTINGS_IMAGE_END;
+}
+
+/// hash of the names and sizes of the settings in the image
+uint16_t parameterImageLayoutHash(){
+  uint16_t hash=5381;
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    if(!isInParameterImage(par))continue;
+    hash=(hash<<5)+hash+par->getLogKey();
+    hash=(hash<<5)+hash+par->getStorageSize();
+  }
+  if(hash==0xFFFF)hash=0xFFFE;	//erased eeprom must not look like a valid image
+  return hash;
+}
+
+/// crc of the values in the image, read in pieces of "size" bytes. If the image fits, "buffer" holds all of it afterwards.
+uint16_t parameterImageCrc(uint8_t* buffer, int size){
+  uint16_t crc=0xFFFF;
+  for(int adress=PAR_SETTINGS_IMAGE_ADRESS+PAR_IMAGE_HEADER_SIZE;adress<PAR_SETTINGS_IMAGE_END;adress+=size){
+    int length=min(size,PAR_SETTINGS_IMAGE_END-adress);
+    eeprom_read_block(buffer,(void*)adress,length);
+    crc=ArduParLogStore::crcUpdate(crc,buffer,length);
+  }
+  return crc;
+}
+
+/// write the crc of the image as it is now, if values in the image were written since the last time. Called at the end of a commit.
+void updateParameterImageCrc(){
+  if(!PAR_SETTINGS_IMAGE_CRC_DIRTY||PAR_SETTINGS_IMAGE_END<0)return;
+  PAR_SETTINGS_IMAGE_CRC_DIRTY=false;
+  uint8_t buffer[16];
+  uint16_t crc=parameterImageCrc(buffer,sizeof(buffer));
+  eeprom_update_block(&crc,(void*)(PAR_SETTINGS_IMAGE_ADRESS+2),2);
+}
+
+/// Load and check the values of all settings that were set up since beginParameterImage(). Call this once, after their setup().
+/// Returns true if all of them were taken from eeprom, false if some or all kept their defaults.
+bool loadParameterImage(){
+  if(PAR_SETTINGS_IMAGE_ADRESS<0||PAR_SETTINGS_IMAGE_END>=0)return false;
+  PAR_SETTINGS_IMAGE_END=EepromAdressManager::nextFreeAdress;
+  int dataAdress=PAR_SETTINGS_IMAGE_ADRESS+PAR_IMAGE_HEADER_SIZE;
+  bool staged=(PAR_SETTINGS_IMAGE_END-dataAdress)<=PAR_SETTINGS_IMAGE_STAGING_SIZE;
+  uint8_t staging[PAR_SETTINGS_IMAGE_STAGING_SIZE];
+  uint16_t header[2];
+  eeprom_read_block(header,(void*)PAR_SETTINGS_IMAGE_ADRESS,PAR_IMAGE_HEADER_SIZE);
+  uint16_t layoutHash=parameterImageLayoutHash();
+  bool allLoaded=(header[0]==layoutHash&&header[1]==parameterImageCrc(staging,sizeof(staging)));
+  if(!allLoaded){
+    Serial.println(F("Parameter image invalid, using defaults"));
+  }else{
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!isInParameterImage(par))continue;
+      const uint8_t* data=staging+(par->getStorageAdress()-dataAdress);
+      if(!staged){
+        if(par->getStorageSize()>PAR_SETTINGS_IMAGE_STAGING_SIZE){
+          Serial.print(F("PAR_SETTINGS_IMAGE_STAGING_SIZE too small for "));
+          Serial.println(par->cmdString);
+          allLoaded=false;
+          continue;
+        }
+        eeprom_read_block(staging,(void*)par->getStorageAdress(),par->getStorageSize());
+        data=staging;
+      }
+      if(!par->loadValue(data)){
+        Serial.print(F("Stored value out of bounds: "));
+        Serial.println(par->cmdString);
+        allLoaded=false;
+      }
+      par->queueChangeNotification();	//publishes the value and marks values derived from it dirty
+    }
+  }
+  if(!allLoaded){
+    //store the defaults, so the next start finds a valid image
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      if(isInParameterImage(PAR_SETTINGS_INSTANCES[i]))PAR_SETTINGS_INSTANCES[i]->storeValue();
+    }
+    header[0]=layoutHash;
+    header[1]=parameterImageCrc(staging,sizeof(staging));
+    eeprom_update_block(header,(void*)PAR_SETTINGS_IMAGE_ADRESS,PAR_IMAGE_HEADER_SIZE);
+  }
+  return allLoaded;
+}
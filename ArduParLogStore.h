@@ -0,0 +1,237 @@
+#pragma once
+#include <avr/eeprom.h>
+#include "EepromAdressManager.h"
+#include "Arduino.h"
+
+// An append-only, wear leveled store for parameter values in EEPROM.
+// Instead of giving each value a fixed adress, every write appends a record to a log:
+//
+//   [payload length][key (2 bytes)][sequence number (2 bytes)][payload][crc16 (2 bytes)]
+//
+// The key is a hash of the parameter name, so values stay where they belong when settings are added or reordered.
+// The region is split into two banks. When the active bank is full, the newest record of every key that is still in use
+// is copied to the other bank, which becomes the active one. Records are renumbered while copying, so the active bank always starts
+// with the highest sequence numbers. After a compaction, the first record of the old bank is invalidated.
+// A power loss during compaction leaves the old bank intact, and begin() finishes the job.
+// A record ends a bank's log if its crc is wrong or its sequence number does not increase, which also rejects stale records from earlier rounds.
+
+// the number of keys the store can keep track of. Keys beyond this are ignored when the log is scanned.
+#ifndef PAR_LOG_STORE_MAX_KEYS
+#define PAR_LOG_STORE_MAX_KEYS 32
+#endif
+
+#define PAR_LOG_STORE_HEADER_SIZE 5	///< length, key and sequence number
+#define PAR_LOG_STORE_RECORD_OVERHEAD (PAR_LOG_STORE_HEADER_SIZE+2)	///< header and crc
+
+class ArduParLogStore{
+public:
+	static int regionStart;			///< first eeprom adress of the store. <0 if the store was not started.
+	static int bankSize;				///< size of each of the two banks
+	static uint8_t activeBank;		///< index of the bank that receives new records
+	static int endAdress;				///< new records are appended here
+	static uint16_t nextSequence;		///< sequence number of the next record
+	static int numKeys;				///< number of used entries in keys[] and recordAdresses[]
+	static uint16_t keys[PAR_LOG_STORE_MAX_KEYS];		///< keys that have a record in the store
+	static int recordAdresses[PAR_LOG_STORE_MAX_KEYS];	///< eeprom adress of the newest record for each key
+	static bool (*keyInUse)(uint16_t key);	///< compaction only keeps keys for which this returns true. 0 keeps all keys.
+
+	/// Use "size" bytes of eeprom starting at "start" for the store and rebuild the key index with one scan over the region.
+	static void begin(int start, int size, bool (*keyInUse)(uint16_t key)=0){
+		regionStart=start;
+		bankSize=size/2;
+		ArduParLogStore::keyInUse=keyInUse;
+		numKeys=0;
+		//the bank that starts with the higher sequence number was written by the latest compaction
+		uint16_t firstSequence[2];
+		bool bankUsed[2];
+		for(uint8_t bank=0;bank<2;bank++){
+			bankUsed[bank]=isValidRecord(bankStart(bank));
+			firstSequence[bank]=bankUsed[bank]?readWord(bankStart(bank)+3):0;
+		}
+		activeBank=0;
+		if(bankUsed[1]&&(!bankUsed[0]||(int16_t)(firstSequence[1]-firstSequence[0])>0))activeBank=1;
+		//scan the old bank first, so records in the active bank replace them
+		scanBank(1-activeBank);
+		endAdress=scanBank(activeBank);
+		//keys that only live in the old bank come from an interrupted compaction. Move them over before the old bank gets reused.
+		for(int i=0;i<numKeys;i++){
+			if(bankOf(recordAdresses[i])!=activeBank){
+				int length=eeprom_read_byte((const uint8_t*)recordAdresses[i]);
+				if(endAdress+PAR_LOG_STORE_RECORD_OVERHEAD+length>bankStart(activeBank)+bankSize)break;
+				recordAdresses[i]=copyRecord(recordAdresses[i],keys[i]);
+			}
+		}
+	}
+
+	/// true if begin() was called
+	static bool isActive(){return regionStart>=0;}
+
+	/// Read the newest value stored for "key" into "data". Returns false and leaves "data" alone if there is none or the size differs.
+	static bool read(uint16_t key, void* data, uint8_t size){
+		int i=findKey(key);
+		if(i<0)return false;
+		int adress=recordAdresses[i];
+		if(eeprom_read_byte((const uint8_t*)adress)!=size)return false;
+		eeprom_read_block(data,(const void*)(adress+PAR_LOG_STORE_HEADER_SIZE),size);
+		return true;
+	}
+
+	/// true if the newest record for "key" holds exactly "data"
+	static bool isStored(uint16_t key, const void* data, uint8_t size){
+		int i=findKey(key);
+		if(i<0)return false;
+		int adress=recordAdresses[i];
+		if(eeprom_read_byte((const uint8_t*)adress)!=size)return false;
+		adress+=PAR_LOG_STORE_HEADER_SIZE;
+		for(uint8_t n=0;n<size;n++){
+			if(eeprom_read_byte((const uint8_t*)(adress+n))!=((const uint8_t*)data)[n])return false;
+		}
+		return true;
+	}
+
+	/// Append a record for "key". Compacts the log if the active bank is full. Returns the number of bytes written, 0 if the value did not fit.
+	static int write(uint16_t key, const void* data, uint8_t size){
+		int recordSize=PAR_LOG_STORE_RECORD_OVERHEAD+size;
+		if(endAdress+recordSize>bankStart(activeBank)+bankSize)compact();
+		if(endAdress+recordSize>bankStart(activeBank)+bankSize){
+			Serial.println(F("Parameter log full"));
+			return 0;
+		}
+		int i=findKey(key);
+		if(i<0){
+			if(numKeys>=PAR_LOG_STORE_MAX_KEYS){
+				Serial.println(F("Max parameter log keys exceeded"));
+				return 0;
+			}
+			i=numKeys++;
+			keys[i]=key;
+		}
+		uint8_t header[PAR_LOG_STORE_HEADER_SIZE]={size,(uint8_t)key,(uint8_t)(key>>8),(uint8_t)nextSequence,(uint8_t)(nextSequence>>8)};
+		uint16_t crc=crcUpdate(0xFFFF,header,PAR_LOG_STORE_HEADER_SIZE);
+		crc=crcUpdate(crc,(const uint8_t*)data,size);
+		eeprom_write_block(header,(void*)endAdress,PAR_LOG_STORE_HEADER_SIZE);
+		eeprom_write_block(data,(void*)(endAdress+PAR_LOG_STORE_HEADER_SIZE),size);
+		writeWord(endAdress+PAR_LOG_STORE_HEADER_SIZE+size,crc);
+		recordAdresses[i]=endAdress;
+		endAdress+=recordSize;
+		nextSequence++;
+		return recordSize;
+	}
+
+	/// Copy the newest record of every key that is still in use to the other bank and continue there.
+	static void compact(){
+		uint8_t oldBank=activeBank;
+		activeBank=1-activeBank;
+		endAdress=bankStart(activeBank);
+		int kept=0;
+		for(int i=0;i<numKeys;i++){
+			if(keyInUse!=0&&!keyInUse(keys[i]))continue;
+			int length=eeprom_read_byte((const uint8_t*)recordAdresses[i]);
+			if(PAR_LOG_STORE_RECORD_OVERHEAD+length>freeBytes()){
+				Serial.println(F("Parameter log full"));
+				break;
+			}
+			recordAdresses[kept]=copyRecord(recordAdresses[i],keys[i]);
+			keys[kept]=keys[i];
+			kept++;
+		}
+		numKeys=kept;
+		//invalidate the first record of the old bank, so begin() knows that the compaction was completed.
+		//An empty new bank would be indistinguishable from a fresh eeprom, so the old bank is left alone then.
+		if(kept>0)eeprom_write_byte((uint8_t*)bankStart(oldBank),0xFF);
+	}
+
+	/// bytes left in the active bank
+	static int freeBytes(){return bankStart(activeBank)+bankSize-endAdress;}
+
+	/// CRC-16/CCITT, like _crc_ccitt_update in avr-libc's util/crc16.h
+	static uint16_t crcUpdate(uint16_t crc, const uint8_t* data, int length){
+		while(length-- >0){
+			uint8_t b=*data++;
+			b^=(uint8_t)crc;
+			b^=b<<4;
+			crc=((((uint16_t)b<<8)|(crc>>8))^(uint8_t)(b>>4)^((uint16_t)b<<3));
+		}
+		return crc;
+	}
+
+private:
+	static int bankStart(uint8_t bank){return regionStart+bank*bankSize;}
+	static uint8_t bankOf(int adress){return adress>=bankStart(1)?1:0;}
+	static uint16_t readWord(int adress){
+		return eeprom_read_byte((const uint8_t*)adress)|((uint16_t)eeprom_read_byte((const uint8_t*)(adress+1))<<8);
+	}
+	static void writeWord(int adress, uint16_t value){
+		uint8_t bytes[2]={(uint8_t)value,(uint8_t)(value>>8)};
+		eeprom_write_block(bytes,(void*)adress,2);
+	}
+	static int findKey(uint16_t key){
+		for(int i=0;i<numKeys;i++)if(keys[i]==key)return i;
+		return -1;
+	}
+
+	/// true if a complete record with a correct crc starts at "adress"
+	static bool isValidRecord(int adress){
+		int bankEnd=bankStart(bankOf(adress))+bankSize;
+		if(adress+PAR_LOG_STORE_RECORD_OVERHEAD>bankEnd)return false;
+		uint8_t length=eeprom_read_byte((const uint8_t*)adress);
+		if(length==0xFF||adress+PAR_LOG_STORE_RECORD_OVERHEAD+length>bankEnd)return false;
+		uint16_t crc=0xFFFF;
+		for(int i=0;i<PAR_LOG_STORE_HEADER_SIZE+length;i++){
+			uint8_t b=eeprom_read_byte((const uint8_t*)(adress+i));
+			crc=crcUpdate(crc,&b,1);
+		}
+		return crc==readWord(adress+PAR_LOG_STORE_HEADER_SIZE+length);
+	}
+
+	/// Add all records of a bank to the key index. Returns the adress after the last record.
+	static int scanBank(uint8_t bank){
+		int adress=bankStart(bank);
+		bool first=true;
+		uint16_t lastSequence=0;
+		while(isValidRecord(adress)){
+			uint16_t sequence=readWord(adress+3);
+			if(!first&&(int16_t)(sequence-lastSequence)<=0)break;	//left over from an earlier round
+			if(first||(int16_t)(sequence-nextSequence)>=0)nextSequence=sequence+1;
+			first=false;
+			lastSequence=sequence;
+			uint16_t key=readWord(adress+1);
+			int i=findKey(key);
+			if(i<0&&numKeys<PAR_LOG_STORE_MAX_KEYS){
+				i=numKeys++;
+				keys[i]=key;
+			}
+			if(i>=0)recordAdresses[i]=adress;
+			adress+=PAR_LOG_STORE_RECORD_OVERHEAD+eeprom_read_byte((const uint8_t*)adress);
+		}
+		return adress;
+	}
+
+	/// append a copy of the record at "adress" with a new sequence number. Returns the adress of the copy.
+	static int copyRecord(int adress, uint16_t key){
+		uint8_t length=eeprom_read_byte((const uint8_t*)adress);
+		int copyAdress=endAdress;
+		uint8_t header[PAR_LOG_STORE_HEADER_SIZE]={length,(uint8_t)key,(uint8_t)(key>>8),(uint8_t)nextSequence,(uint8_t)(nextSequence>>8)};
+		uint16_t crc=crcUpdate(0xFFFF,header,PAR_LOG_STORE_HEADER_SIZE);
+		eeprom_write_block(header,(void*)copyAdress,PAR_LOG_STORE_HEADER_SIZE);
+		for(uint8_t n=0;n<length;n++){
+			uint8_t b=eeprom_read_byte((const uint8_t*)(adress+PAR_LOG_STORE_HEADER_SIZE+n));
+			eeprom_write_byte((uint8_t*)(copyAdress+PAR_LOG_STORE_HEADER_SIZE+n),b);
+			crc=crcUpdate(crc,&b,1);
+		}
+		writeWord(copyAdress+PAR_LOG_STORE_HEADER_SIZE+length,crc);
+		endAdress+=PAR_LOG_STORE_RECORD_OVERHEAD+length;
+		nextSequence++;
+		return copyAdress;
+	}
+};
+
+int ArduParLogStore::regionStart=-1;
+int ArduParLogStore::bankSize=0;
+uint8_t ArduParLogStore::activeBank=0;
+int ArduParLogStore::endAdress=0;
+uint16_t ArduParLogStore::nextSequence=0;
+int ArduParLogStore::numKeys=0;
+uint16_t ArduParLogStore::keys[PAR_LOG_STORE_MAX_KEYS];
+int ArduParLogStore::recordAdresses[PAR_LOG_STORE_MAX_KEYS];
+bool (*ArduParLogStore::keyInUse)(uint16_t key)=0;
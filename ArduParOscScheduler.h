@@ -0,0 +1,237 @@
+#pragma once
+// OSC packets with bundles and timetags. Included by ArduPar.h.
+//
+// ArdOSCForWiFlyHQ delivers single messages as they arrive. For updates that have to happen at the same time on several boards,
+// hand the raw UDP packets to dispatchOscPacket() instead. It decodes messages and bundles (also nested ones) without the OSC library.
+// Bundles with a timetag in the future are kept in a small time ordered queue and applied by applyScheduledParameters()
+// when micros() reaches their deadline. All updates of a bundle are applied together, in one parameter batch.
+//
+// Timetags are NTP times (seconds since 1900 and a 32 bit fraction). The board does not know the NTP time by itself,
+// so call syncOscTime() whenever you learn it, i.e. from a sync message of the sender. Until then, all bundles are applied immediately.
+// micros() wraps around after about 71 minutes, so timetags have to be within half an hour of the last sync.
+//
+// Only the first argument of each message is used, like for OSC messages to single settings. With USE_OSC, packets only reach
+// settings that were set up with an OSCServer, the same ones as messages through ArduParOscRouter.
+// Scheduled bundles can not contain string or blob arguments, because the packet buffer is gone when they are applied.
+
+// the number of updates that can wait for their deadline. Each takes about 17 bytes of RAM on AVR.
+#ifndef PAR_SETTINGS_OSC_QUEUE_SIZE
+#define PAR_SETTINGS_OSC_QUEUE_SIZE 8
+#endif
+
+#define PAR_OSC_MAX_SCHEDULE_SECONDS 1800	///< timetags further ahead of the last sync are rejected
+
+/// an update that waits for its deadline
+struct ArduParScheduledUpdate{
+  unsigned long deadline;	///< micros() at which the update is applied
+  AbstractArduPar* par;
+  ArduParArgument arg;
+};
+
+ArduParScheduledUpdate PAR_SETTINGS_OSC_QUEUE[PAR_SETTINGS_OSC_QUEUE_SIZE];	///< ordered by deadline
+int PAR_SETTINGS_OSC_QUEUE_LENGTH=0;
+bool PAR_SETTINGS_OSC_TIME_SYNCED=false;		///< false until syncOscTime() was called
+uint32_t PAR_SETTINGS_OSC_SYNC_SECONDS=0;		///< NTP time at the last sync
+uint32_t PAR_SETTINGS_OSC_SYNC_FRACTION=0;
+unsigned long PAR_SETTINGS_OSC_SYNC_MICROS=0;	///< micros() at the last sync
+
+/// Tell the library that the NTP time is "seconds"."fraction" right now. Needed to schedule bundles.
+void syncOscTime(uint32_t seconds, uint32_t fraction){
+  PAR_SETTINGS_OSC_SYNC_SECONDS=seconds;
+  PAR_SETTINGS_OSC_SYNC_FRACTION=fraction;
+  PAR_SETTINGS_OSC_SYNC_MICROS=micros();
+  PAR_SETTINGS_OSC_TIME_SYNCED=true;
+}
+
+/// read a big endian 32 bit number, as used by OSC
+uint32_t readOscInt32(const uint8_t* data){
+  return ((uint32_t)data[0]<<24)|((uint32_t)data[1]<<16)|((uint32_t)data[2]<<8)|data[3];
+}
+
+/// the position after the zero terminated and padded OSC string that starts at "start", or -1 if it does not end within "size"
+int oscStringEnd(const uint8_t* data, int start, int size){
+  for(int i=start;i<size;i++){
+    if(data[i]==0){
+      int end=start+((i-start)/4+1)*4;
+      return end<=size?end:-1;
+    }
+  }
+  return -1;
+}
+
+/// Convert an OSC timetag to a deadline in micros(). Returns 1 if the bundle is due now, 0 if it has to wait and -1 if it is too far ahead.
+int oscTimetagToMicros(const uint8_t* timetag, unsigned long* deadline){
+  uint32_t seconds=readOscInt32(timetag);
+  uint32_t fraction=readOscInt32(timetag+4);
+  if(!PAR_SETTINGS_OSC_TIME_SYNCED||(seconds==0&&fraction==1))return 1;	//1 means "immediately"
+  seconds-=PAR_SETTINGS_OSC_SYNC_SECONDS;
+  if(fraction<PAR_SETTINGS_OSC_SYNC_FRACTION)seconds--;
+  fraction-=PAR_SETTINGS_OSC_SYNC_FRACTION;
+  if((int32_t)seconds<0)return 1;	//before the last sync
+  if(seconds>PAR_OSC_MAX_SCHEDULE_SECONDS)return -1;
+  //fraction*1000000/2^32 without 64 bit math: 1000000/2^32=15625/2^26
+  *deadline=PAR_SETTINGS_OSC_SYNC_MICROS+seconds*1000000UL+(((fraction>>16)*15625UL)>>10);
+  return (long)(*deadline-micros())<=0?1:0;
+}
+
+/// Decode an OSC message. Gives the adress and the first argument, 't' if there is none. Returns false for malformed messages and unknown argument types.
+bool decodeOscMessage(const uint8_t* data, int size, const char** adress, ArduParArgument* arg){
+  int pos=oscStringEnd(data,0,size);
+  if(pos<0||data[0]!='/')return false;
+  *adress=(const char*)data;
+  arg->typeTag='t';
+  if(pos==size)return true;	//no type tags, no arguments
+  if(data[pos]!=',')return false;
+  int tagStart=pos;
+  pos=oscStringEnd(data,pos,size);
+  if(pos<0)return false;
+  char tag=data[tagStart+1];	//the type tags end within "size", so this is at most their terminating 0
+  switch(tag){
+    case 0:
+      return true;
+    case 'i':
+      if(pos+4>size)return false;
+      arg->typeTag='l';
+      arg->intValue=(int32_t)readOscInt32(data+pos);
+      return true;
+    case 'f':{
+      if(pos+4>size)return false;
+      uint32_t bits=readOscInt32(data+pos);
+      arg->typeTag='f';
+      memcpy(&arg->floatValue,&bits,4);
+      return true;
+    }
+    case 's':
+      if(oscStringEnd(data,pos,size)<0)return false;
+      arg->typeTag='s';
+      arg->stringValue=(const char*)data+pos;
+      return true;
+    case 'b':
+      if(pos+4>size)return false;
+      arg->typeTag='b';
+      arg->intValue=(int32_t)readOscInt32(data+pos);
+      arg->stringValue=(const char*)data+pos+4;
+      return arg->intValue>=0&&arg->intValue<=size-pos-4;
+    case 'T':
+    case 'F':
+      arg->typeTag='l';
+      arg->intValue=(tag=='T');
+      return true;
+  }
+  return false;
+}
+
+/// put an update into the queue, behind the ones with the same or an earlier deadline
+void queueScheduledUpdate(unsigned long deadline, AbstractArduPar* par, ArduParArgument* arg){
+  int i=PAR_SETTINGS_OSC_QUEUE_LENGTH;
+  while(i>0&&(long)(PAR_SETTINGS_OSC_QUEUE[i-1].deadline-deadline)>0){
+    PAR_SETTINGS_OSC_QUEUE[i]=PAR_SETTINGS_OSC_QUEUE[i-1];
+    i--;
+  }
+  PAR_SETTINGS_OSC_QUEUE[i].deadline=deadline;
+  PAR_SETTINGS_OSC_QUEUE[i].par=par;
+  PAR_SETTINGS_OSC_QUEUE[i].arg=*arg;
+  PAR_SETTINGS_OSC_QUEUE_LENGTH++;
+}
+
+/// true if OSC packets may set "par". With USE_OSC, like for ArduParOscRouter, only settings that were set up with an OSCServer can be.
+/// Without it, there is no other way for OSC to get in, so all settings can be.
+bool isOscReachable(AbstractArduPar* par){
+#ifdef USE_OSC
+  return par->oscEnabled;
+#else
+  return true;
+#endif
+}
+
+/// Set, queue or just count (if "apply" is false) the settings a message is meant for. Returns the number of settings, -1 if there is none.
+int deliverOscMessage(const char* adress, ArduParArgument* arg, bool due, unsigned long deadline, bool apply){
+  int count=0;
+  if(!isOscPattern(adress)){
+    AbstractArduPar* par=findParameter(adress,strlen(adress));
+    if(par==0||!isOscReachable(par))return -1;
+    if(apply){
+      PAR_STAT(par->countUpdate());
+      if(due)par->receiveArgument(arg);
+      else queueScheduledUpdate(deadline,par,arg);
+    }
+    return 1;
+  }
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    if(!isOscReachable(par)||!matchOscPattern(adress,(const char PROGMEM *)par->cmdString))continue;
+    count++;
+    if(apply){
+      PAR_STAT(par->countUpdate());
+      if(due)par->receiveArgument(arg);
+      else queueScheduledUpdate(deadline,par,arg);
+    }
+  }
+  return count>0?count:-1;
+}
+
+/// Walk through a message or a bundle. Returns the number of updates that have to wait, or -1 if something in it is invalid.
+/// Bundles inside bundles have their own timetag.
+int walkOscPacket(const uint8_t* data, int size, bool due, unsigned long deadline, bool apply){
+  if(size>=16&&memcmp(data,"#bundle",8)==0){
+    int timing=oscTimetagToMicros(data+8,&deadline);
+    if(timing<0)return -1;
+    due=(timing==1);
+    int waiting=0;
+    int pos=16;
+    while(pos<size){
+      if(pos+4>size)return -1;
+      int32_t length=(int32_t)readOscInt32(data+pos);
+      pos+=4;
+      if(length<=0||length%4!=0||length>size-pos)return -1;
+      int n=walkOscPacket(data+pos,length,due,deadline,apply);
+      if(n<0)return -1;
+      waiting+=n;
+      pos+=length;
+    }
+    return waiting;
+  }
+  const char* adress;
+  ArduParArgument arg;
+  if(!decodeOscMessage(data,size,&adress,&arg))return -1;
+  if(!due&&(arg.typeTag=='s'||arg.typeTag=='b'))return -1;
+  int count=deliverOscMessage(adress,&arg,due,deadline,apply);
+  if(count<0)return -1;
+  return due?0:count;
+}
+
+/// Apply a raw OSC packet, i.e. the contents of a UDP datagram. Messages and bundles that are due are applied right away,
+/// bundles with a later timetag are queued for applyScheduledParameters(). Like a batch of serial commands,
+/// nothing is applied if any message in the packet is invalid or for an unknown setting, or if the queue has no room for all of it.
+/// Returns false if the packet was rejected.
+bool dispatchOscPacket(const uint8_t* data, int size){
+  int waiting=walkOscPacket(data,size,true,0,false);
+  if(waiting<0){
+    Serial.println(F("Invalid OSC packet"));
+    PAR_STAT(PAR_SETTINGS_LIBRARY_STATS.unknownCommands++);
+    return false;
+  }
+  if(waiting>PAR_SETTINGS_OSC_QUEUE_SIZE-PAR_SETTINGS_OSC_QUEUE_LENGTH){
+    Serial.println(F("OSC queue full"));
+    return false;
+  }
+  beginParameterBatch();
+  walkOscPacket(data,size,true,0,true);
+  endParameterBatch();
+  return true;
+}
+
+/// Apply all queued updates whose deadline has come, in one batch. Call this often in loop(), the timing is only as precise as the calls.
+/// Returns the number of updates that were applied.
+int applyScheduledParameters(){
+  unsigned long now=micros();
+  int due=0;
+  while(due<PAR_SETTINGS_OSC_QUEUE_LENGTH&&(long)(now-PAR_SETTINGS_OSC_QUEUE[due].deadline)>=0)due++;
+  if(due==0)return 0;
+  beginParameterBatch();
+  for(int i=0;i<due;i++)PAR_SETTINGS_OSC_QUEUE[i].par->receiveArgument(&PAR_SETTINGS_OSC_QUEUE[i].arg);
+  endParameterBatch();
+  PAR_SETTINGS_OSC_QUEUE_LENGTH-=due;
+  memmove(PAR_SETTINGS_OSC_QUEUE,PAR_SETTINGS_OSC_QUEUE+due,PAR_SETTINGS_OSC_QUEUE_LENGTH*sizeof(ArduParScheduledUpdate));
+  return due;
+}
@@ -0,0 +1,256 @@
+#pragma once
+// Preset banks: snapshots of all persistent settings. Included by ArduPar.h.
+//
+// A PresetBankArduPar reserves "numSlots" blocks of eeprom from the EepromAdressManager. Each slot holds the values of all
+// settings that are persistent, in the order they were set up, behind a 2 byte header with a hash of their names and sizes.
+// If settings are added, removed or change their size after a slot was stored, the hash does not match and the slot counts as empty.
+// The hash is written last, so a slot whose store was cut short by a reset counts as empty as well.
+// Tables are not part of presets.
+//
+//   preset store 3          copies all persistent values into slot 3
+//   preset recall 3         loads slot 3
+//   preset recall 3 2000    fades numeric settings to slot 3 within 2 seconds
+//
+// A recall is applied as one batch: all values are read first, then each setting checks its bounds, and change notifications
+// are queued once per setting. Nothing in between is visible to dispatchParameterChanges().
+//
+// Fades need PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE bytes of RAM for the start values and are run by update(), which you call in loop().
+// With a buffer size of 0, fades are left out: a recall with a fade time says so and loads the slot at once.
+// Int, long, float and fixed point settings move in steps, strings and arrays change at the end, when the slot is recalled as above.
+// Settings that do not fit into the buffer also change at the end.
+//
+// Example:
+//   PresetBankArduPar presets;
+//   ...
+//   presets.setup(F("preset"),4);   //after all other settings
+//   ...
+//   presets.update();
+
+// RAM for the start values of a fade, enough for four int, long or float settings. 0 leaves fades out.
+#ifndef PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE
+#define PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE 16
+#endif
+
+#define PAR_PRESET_HEADER_SIZE 2	///< the layout hash in front of each slot
+
+////////////////////
+/// Stores and recalls snapshots of all persistent settings in eeprom slots.
+class PresetBankArduPar:
+public AbstractArduPar{
+public:
+  int numSlots;				///< number of slots
+  int firstSlotAdress;		///< eeprom adress of the first slot
+  int snapshotSize;			///< bytes of values in each slot
+  uint16_t layoutHash;		///< hash of the names and sizes of all persistent settings
+#if PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE>0
+  uint8_t fadeStart[PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE];	///< values when the fade started
+  int fadeSlot;				///< slot the fade goes to, -1 if none is running
+  unsigned long fadeStartMillis;
+  unsigned long fadeDuration;
+#endif
+
+  /// Set up the bank. Has to be called after all settings that should be part of presets were set up.
+  void setup(
+    const __FlashStringHelper* cmdString,
+    int numSlots,					///< number of snapshots that can be stored
+    int fixedEEPROMAdress=-1		///< if you want a specific fixed adress for the first slot, specify it here
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    this->numSlots=numSlots;
+    snapshotSize=0;
+    layoutHash=5381;
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!isPartOfPresets(par))continue;
+      snapshotSize+=par->getValueSize();
+      layoutHash=(layoutHash<<5)+layoutHash+par->getLogKey();
+      layoutHash=(layoutHash<<5)+layoutHash+par->getValueSize();
+    }
+    if(layoutHash==0xFFFF)layoutHash=0xFFFE;	//erased eeprom must not look like a stored slot
+    if(fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(numSlots*(PAR_PRESET_HEADER_SIZE+snapshotSize));
+    firstSlotAdress=fixedEEPROMAdress;
+#if PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE>0
+    fadeSlot=-1;
+#endif
+  }
+
+  /// "store N" or "recall N [fadeMillis]"
+  virtual void parseParameterString(char* data){
+    while(*data==' ')data++;
+    bool store=strncmp_P(data,PSTR("store"),5)==0;
+    if(!store&&strncmp_P(data,PSTR("recall"),6)!=0){
+      PAR_STAT(stats.parseErrors++);
+      Serial.println(F("Unknown preset command"));
+      return;
+    }
+    while(*data>' ')data++;
+    int slot=atoi(data);
+    while(*data==' ')data++;
+    while(*data>' ')data++;
+    unsigned long fadeMillis=strtoul(data,0,10);
+    if(store)this->store(slot);
+    else recall(slot,fadeMillis);
+  }
+
+  /// a number recalls that slot
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='l'||arg->typeTag=='i')recall(arg->intValue);
+    else if(arg->typeTag=='f')recall((int)arg->floatValue);
+  }
+
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='i')recall(_mes->getArgInt32(0));
+  }
+#endif
+
+  /// copy the current values of all persistent settings into "slot". Returns false if there is no such slot.
+  bool store(int slot){
+    if(slot<0||slot>=numSlots){
+      Serial.println(F("No such preset slot"));
+      return false;
+    }
+    //the slot is empty while its values are written, so a reset in between does not leave a mix of old and new values
+    int adress=slotAdress(slot);
+    uint16_t emptyHeader=0xFFFF;
+    eeprom_update_block(&emptyHeader,(void*)adress,PAR_PRESET_HEADER_SIZE);
+    adress+=PAR_PRESET_HEADER_SIZE;
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!isPartOfPresets(par))continue;
+      eeprom_update_block(par->getValueData(),(void*)adress,par->getValueSize());
+      adress+=par->getValueSize();
+    }
+    eeprom_update_block(&layoutHash,(void*)slotAdress(slot),PAR_PRESET_HEADER_SIZE);
+    TRACE((F("Stored preset ")));
+    TRACELN((slot));
+    return true;
+  }
+
+  /// Load all values from "slot" at once, or start fading to them within "fadeMillis". Returns false if the slot is empty or does not exist.
+  /// Without a fade buffer, the values are loaded at once in any case.
+  bool recall(int slot, unsigned long fadeMillis=0){
+    if(!isStored(slot)){
+      Serial.println(F("Preset slot empty"));
+      return false;
+    }
+#if PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE>0
+    fadeSlot=-1;
+    if(fadeMillis>0){
+      int used=0;
+      for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+        AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+        if(!isPartOfPresets(par))continue;
+        int size=par->getValueSize();
+        if(used+size>PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE)break;
+        memcpy(fadeStart+used,par->getValueData(),size);
+        used+=size;
+      }
+      fadeSlot=slot;
+      fadeStartMillis=millis();
+      fadeDuration=fadeMillis;
+      return true;
+    }
+#else
+    if(fadeMillis>0)Serial.println(F("Preset fades disabled"));
+#endif
+    loadSlot(slot);
+    return true;
+  }
+
+  /// true if "slot" holds a snapshot of the current set of settings
+  bool isStored(int slot){
+    if(slot<0||slot>=numSlots)return false;
+    uint16_t storedHash;
+    eeprom_read_block(&storedHash,(void*)slotAdress(slot),PAR_PRESET_HEADER_SIZE);
+    return storedHash==layoutHash;
+  }
+
+  /// true while a fade is running
+  bool isFading(){
+#if PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE>0
+    return fadeSlot>=0;
+#else
+    return false;
+#endif
+  }
+
+  /// Move a running fade on. Call this often in loop(), each call is one step. Returns true while the fade is running.
+  /// Values in between are neither checked nor persisted, only their change notifications are queued.
+  bool update(){
+#if PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE>0
+    if(fadeSlot<0)return false;
+    unsigned long elapsed=millis()-fadeStartMillis;
+    if(elapsed>=fadeDuration){
+      int slot=fadeSlot;
+      fadeSlot=-1;
+      loadSlot(slot);
+      return false;
+    }
+    uint16_t fraction=(uint16_t)(elapsed*256/fadeDuration);
+    int adress=slotAdress(fadeSlot)+PAR_PRESET_HEADER_SIZE;
+    int used=0;
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!isPartOfPresets(par))continue;
+      int size=par->getValueSize();
+      if(used+size>PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE)break;
+      uint8_t target[sizeof(double)>sizeof(long)?sizeof(double):sizeof(long)];
+      if(size<=(int)sizeof(target)){
+        eeprom_read_block(target,(void*)adress,size);
+        if(par->interpolateValue(fadeStart+used,target,fraction))par->queueChangeNotification();
+      }
+      used+=size;
+      adress+=size;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /// give human&machine readably status info
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("preset\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(numSlots);
+    out->print(F("\n"));
+  }
+
+private:
+  int slotAdress(int slot){return firstSlotAdress+slot*(PAR_PRESET_HEADER_SIZE+snapshotSize);}
+
+  /// settings that are stored in presets. Tables are left out, because only their selected entry has a value.
+  bool isPartOfPresets(AbstractArduPar* par){
+    return par!=this&&!par->isTable()&&par->isPersistent()&&par->getValueSize()>0;
+  }
+
+  /// read the snapshot in "slot" in one pass and apply it as one batch
+  void loadSlot(int slot){
+    int adress=slotAdress(slot)+PAR_PRESET_HEADER_SIZE;
+    beginParameterBatch();
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(!isPartOfPresets(par))continue;
+      eeprom_read_block(par->getValueData(),(void*)adress,par->getValueSize());
+      adress+=par->getValueSize();
+    }
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+      if(isPartOfPresets(par))par->valueLoaded();
+    }
+    endParameterBatch();
+    TRACE((F("Recalled preset ")));
+    TRACELN((slot));
+  }
+};
@@ -0,0 +1,51 @@
+#pragma once
+// Settings that are read by interrupt routines. Included by ArduPar.h.
+//
+// On an 8 bit AVR, setting a long or float takes four separate stores, an int two. An interrupt that reads the value
+// in between sees half of the old and half of the new value. A PublishedArduPar keeps two copies for interrupt routines
+// and a one byte index of the current one. A new value goes into the other copy first, then the index is switched with
+// a single store. The main loop never writes the copy that an interrupt routine can read, so read() always gives a whole value,
+// in a few cycles and without disabling interrupts.
+//
+// read() is meant for interrupt routines, which the main loop can not interrupt. The main loop can use the value itself as before.
+// Values are published whenever they change: by commands, setValue(), presets and loadParameterImage().
+//
+// Example:
+//   PublishedArduPar<LongArduPar> stepInterval;
+//   ...
+//   stepInterval.setup(F("interval"),10,100000);
+//   ...
+//   ISR(TIMER1_COMPA_vect){
+//     OCR1A=stepInterval.read();
+//   }
+
+////////////////////
+/// A setting of type Setting (i.e. IntArduPar, LongArduPar, FloatArduPar or a FixedArduPar) whose value can be read by interrupt routines without tearing.
+template<class Setting> class PublishedArduPar:
+public Setting{
+public:
+  typedef decltype(Setting::value) ValueType;
+  volatile ValueType publishedValues[2];	///< the copies for interrupt routines
+  volatile uint8_t publishedIndex;			///< index of the copy that is read
+
+  PublishedArduPar():publishedIndex(0){
+    publishedValues[0]=publishedValues[1]=0;
+  }
+
+  /// takes the same arguments as Setting::setup() and publishes the value it starts with
+  template<typename... Args> void setup(Args... args){
+    Setting::setup(args...);
+    publishValue();
+  }
+
+  /// the value, as last published. Safe to call in interrupt routines.
+  ValueType read() const{
+    return publishedValues[publishedIndex];
+  }
+
+  virtual void publishValue(){
+    uint8_t next=publishedIndex^1;
+    publishedValues[next]=*this->valuePointer;
+    publishedIndex=next;	//one store, so interrupts see either the old or the new copy
+  }
+};
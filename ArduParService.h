@@ -0,0 +1,180 @@
+#pragma once
+// All the work of the library in one call with a time budget. Included by ArduPar.h.
+//
+// serviceParameters(budgetMicros) does the work that is waiting, most urgent first, and stops once the budget is used up:
+//   1. OSC updates whose deadline has come (applyScheduledParameters())
+//   2. reading commands from the streams that were added with addParameterStream(), PAR_SETTINGS_SERVICE_CHUNK bytes at a time
+//   3. computing derived values whose sources changed, one at a time
+//   4. change callbacks, one at a time
+//   5. eeprom writes, one byte per call and only if the eeprom is not busy with the last one.
+//      An element of an array or a record of the parameter log is written as a whole, so it can take more than one byte.
+//   6. a dump started with beginServiceDump(), one setting at a time, and the feedback publisher in PAR_SETTINGS_SERVICE.feedback
+// What is left is done by the next calls. A step is never interrupted, so a call can take longer than the budget by the time of
+// the longest step, i.e. a change callback of yours. Such calls are counted as overruns in PAR_SETTINGS_SERVICE_REPORT,
+// together with the longest call and the work that was left after the last call. Use them to size the budget.
+//
+// Set PAR_SETTINGS_PERSISTENCE.deferred=true, otherwise every value is written to eeprom as soon as its command is parsed.
+// The commit interval and bytes per commit of PAR_SETTINGS_PERSISTENCE still apply, the writes of a commit are just spread over several calls.
+// OSC messages that ArdOSC delivers by itself, through availableCheck(), are not covered. Hand raw packets to dispatchOscPacket() instead.
+//
+// Example:
+//   addParameterStream(&Serial,50);
+//   PAR_SETTINGS_PERSISTENCE.deferred=true;
+//   ...
+//   serviceParameters(200);   //in loop(), at most about 200us per call
+//   ...
+//   dumpServiceReport(&Serial);
+
+// bytes read from a stream between two looks at the clock
+#ifndef PAR_SETTINGS_SERVICE_CHUNK
+#define PAR_SETTINGS_SERVICE_CHUNK 8
+#endif
+
+struct ArduParServiceSettings{
+  ArduParFeedbackPublisher* feedback;	///< sends changed values as the last step of serviceParameters(). 0 for none.
+  Stream* dumpStream;					///< a dump started by beginServiceDump() goes here. 0 if there is none.
+  int dumpCursor;						///< next setting to dump
+  int commitBytesLeft;					///< bytes the running commit may still write, 0 if none is running, -1 for no limit
+};
+/// Change this to have feedback sent by serviceParameters(). i.e. PAR_SETTINGS_SERVICE.feedback=&feedback;
+ArduParServiceSettings PAR_SETTINGS_SERVICE={0,0,0,0};
+
+/// What serviceParameters() did and what it left
+struct ArduParServiceReport{
+  unsigned long calls;
+  unsigned long overruns;		///< calls that took longer than their budget
+  unsigned long maxMicros;		///< the longest call
+  unsigned long lastMicros;		///< the last call
+  int inputBacklog;				///< bytes waiting in the streams
+  int scheduledBacklog;			///< OSC updates waiting for their deadline
+  int derivedBacklog;			///< derived values waiting to be computed
+  int changeBacklog;			///< settings and groups waiting for their change callback
+  int commitBacklog;			///< settings waiting to be written to eeprom
+  int dumpBacklog;				///< settings left in the dump
+};
+ArduParServiceReport PAR_SETTINGS_SERVICE_REPORT;
+
+/// true if the eeprom can be written without waiting for the last write to finish
+bool isEepromReady(){
+#ifdef eeprom_is_ready
+  return eeprom_is_ready();
+#else
+  return true;
+#endif
+}
+
+/// Dump all settings to "outStream" from serviceParameters(), a few at a time. A dump that is still running starts over.
+void beginServiceDump(Stream* outStream){
+  PAR_SETTINGS_SERVICE.dumpStream=outStream;
+  PAR_SETTINGS_SERVICE.dumpCursor=0;
+}
+
+/// Do waiting work of the library, most urgent first, for about "budgetMicros". Call this in loop() instead of the single update functions.
+/// Each call does at least one piece of work, even with a budget of 0, so the backlog keeps shrinking when every call overruns.
+/// Returns the time the call took in us.
+unsigned long serviceParameters(unsigned long budgetMicros){
+  unsigned long start=micros();
+  int work=0;	//pieces of work done so far
+  #define PAR_SERVICE_MAY_CONTINUE (work==0||micros()-start<budgetMicros)
+  //1. updates that are due now
+  work+=applyScheduledParameters();
+  //2. commands, a few bytes at a time
+  for(int i=0;i<PAR_SETTINGS_MAX_STREAMS;i++){
+    ArduParStreamParser* parser=&PAR_SETTINGS_STREAM_PARSERS[i];
+    if(parser->stream==0)continue;
+    while(parser->stream->available()>0&&PAR_SERVICE_MAY_CONTINUE){
+      parser->update(PAR_SETTINGS_SERVICE_CHUNK);
+      work++;
+    }
+    parser->update(0);	//finishes a command that timed out
+  }
+  //3. derived values, each after its sources
+  for(int i=0;i<PAR_SETTINGS_CUR_DERIVED_NUMBER&&PAR_SERVICE_MAY_CONTINUE;i++){
+    if(PAR_SETTINGS_DERIVED[i]->update())work++;
+  }
+  //4. change callbacks
+  while(PAR_SETTINGS_NUM_CHANGED_INSTANCES+PAR_SETTINGS_NUM_CHANGED_GROUPS>0&&PAR_SERVICE_MAY_CONTINUE){
+    if(dispatchParameterChanges(1)==0)break;	//a batch is running
+    work++;
+  }
+  //5. eeprom, a byte at a time. The write runs in the background until the next call.
+  if(PAR_SETTINGS_SERVICE.commitBytesLeft==0&&millis()-PAR_SETTINGS_LAST_COMMIT_MILLIS>=PAR_SETTINGS_PERSISTENCE.minCommitInterval){
+    for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+      if(PAR_SETTINGS_INSTANCES[i]->valueDirty){
+        PAR_SETTINGS_SERVICE.commitBytesLeft=PAR_SETTINGS_PERSISTENCE.maxBytesPerCommit;
+        PAR_SETTINGS_LAST_COMMIT_MILLIS=millis();
+        break;
+      }
+    }
+  }
+  if(PAR_SETTINGS_SERVICE.commitBytesLeft!=0&&PAR_SERVICE_MAY_CONTINUE&&isEepromReady()){
+    bool foundDirty;
+    int written=writeDirtyParameters(1,&foundDirty);
+    if(!foundDirty)PAR_SETTINGS_SERVICE.commitBytesLeft=0;
+    else if(PAR_SETTINGS_SERVICE.commitBytesLeft>0)PAR_SETTINGS_SERVICE.commitBytesLeft=max(PAR_SETTINGS_SERVICE.commitBytesLeft-written,0);
+    if(PAR_SETTINGS_SERVICE.commitBytesLeft==0)updateParameterImageCrc();	//the commit is done
+    work+=written;
+  }
+  //6. output
+  if(PAR_SETTINGS_SERVICE.dumpStream!=0){
+    while(PAR_SETTINGS_SERVICE.dumpCursor<PAR_SETTINGS_CUR_INSTANCE_NUMBER&&PAR_SERVICE_MAY_CONTINUE){
+      PAR_SETTINGS_SERVICE.dumpCursor=dumpParameterInfos(PAR_SETTINGS_SERVICE.dumpStream,PAR_SETTINGS_SERVICE.dumpCursor,1);
+      work++;
+    }
+    if(PAR_SETTINGS_SERVICE.dumpCursor>=PAR_SETTINGS_CUR_INSTANCE_NUMBER)PAR_SETTINGS_SERVICE.dumpStream=0;
+  }
+  if(PAR_SETTINGS_SERVICE.feedback!=0&&PAR_SERVICE_MAY_CONTINUE)PAR_SETTINGS_SERVICE.feedback->update();
+  #undef PAR_SERVICE_MAY_CONTINUE
+
+  //report
+  ArduParServiceReport& report=PAR_SETTINGS_SERVICE_REPORT;
+  unsigned long elapsed=micros()-start;
+  report.calls++;
+  if(elapsed>budgetMicros)report.overruns++;
+  if(elapsed>report.maxMicros)report.maxMicros=elapsed;
+  report.lastMicros=elapsed;
+  report.inputBacklog=0;
+  for(int i=0;i<PAR_SETTINGS_MAX_STREAMS;i++){
+    if(PAR_SETTINGS_STREAM_PARSERS[i].stream!=0)report.inputBacklog+=PAR_SETTINGS_STREAM_PARSERS[i].stream->available();
+  }
+  report.scheduledBacklog=PAR_SETTINGS_OSC_QUEUE_LENGTH;
+  report.derivedBacklog=0;
+  for(int i=0;i<PAR_SETTINGS_CUR_DERIVED_NUMBER;i++)if(PAR_SETTINGS_DERIVED[i]->dirty)report.derivedBacklog++;
+  report.changeBacklog=PAR_SETTINGS_NUM_CHANGED_INSTANCES+PAR_SETTINGS_NUM_CHANGED_GROUPS;
+  report.commitBacklog=0;
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++)if(PAR_SETTINGS_INSTANCES[i]->valueDirty)report.commitBacklog++;
+  report.dumpBacklog=PAR_SETTINGS_SERVICE.dumpStream==0?0:PAR_SETTINGS_CUR_INSTANCE_NUMBER-PAR_SETTINGS_SERVICE.dumpCursor;
+  return elapsed;
+}
+
+/// Print PAR_SETTINGS_SERVICE_REPORT as one line:
+/// service	calls	overruns	maxMicros	lastMicros	input	scheduled	derived	changes	commits	dump
+void dumpServiceReport(Stream* out){
+  ArduParServiceReport& report=PAR_SETTINGS_SERVICE_REPORT;
+  out->print(F("service\t"));
+  out->print(report.calls);
+  out->print(F("\t"));
+  out->print(report.overruns);
+  out->print(F("\t"));
+  out->print(report.maxMicros);
+  out->print(F("\t"));
+  out->print(report.lastMicros);
+  out->print(F("\t"));
+  out->print(report.inputBacklog);
+  out->print(F("\t"));
+  out->print(report.scheduledBacklog);
+  out->print(F("\t"));
+  out->print(report.derivedBacklog);
+  out->print(F("\t"));
+  out->print(report.changeBacklog);
+  out->print(F("\t"));
+  out->print(report.commitBacklog);
+  out->print(F("\t"));
+  out->print(report.dumpBacklog);
+  out->print(F("\n"));
+}
+
+/// Start over with the counters of PAR_SETTINGS_SERVICE_REPORT
+void resetServiceReport(){
+  memset(&PAR_SETTINGS_SERVICE_REPORT,0,sizeof(PAR_SETTINGS_SERVICE_REPORT));
+}
@@ -0,0 +1,110 @@
+#pragma once
+// Runtime statistics. Included by ArduPar.h.
+//
+// With PAR_SETTINGS_STATS defined as 1 before ArduPar.h is included, every setting counts the updates it received,
+// values that were out of bounds, values that could not be parsed and the eeprom bytes it wrote (see ArduParStats).
+// PAR_SETTINGS_LIBRARY_STATS sums up the time spent parsing input, dispatching change notifications and writing eeprom.
+// Otherwise, none of this is compiled and settings are as small and fast as without it.
+//
+// The numbers can be read from the "stats" member of a setting and from PAR_SETTINGS_LIBRARY_STATS,
+// or printed by dumpParameterStats() and by a StatsArduPar command:
+//
+//   stats     prints a line for every setting, then the library line
+//   stats 0   prints the same and resets all counters
+//
+// Lines are tab separated, like the output of dumpParameterInfos():
+//   stats  <name>  <updates>  <clamped>  <parse errors>  <eeprom bytes>  <millis at last update>
+//   timing  <parse µs>  <dispatch µs>  <eeprom µs>  <unknown commands>
+
+#if PAR_SETTINGS_STATS
+
+/// set all counters to 0
+void resetParameterStats(){
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    memset(&PAR_SETTINGS_INSTANCES[i]->stats,0,sizeof(ArduParStats));
+  }
+  memset(&PAR_SETTINGS_LIBRARY_STATS,0,sizeof(PAR_SETTINGS_LIBRARY_STATS));
+}
+
+/// write the statistics of all settings and of the library to a stream
+void dumpParameterStats(Stream* outStream){
+  ArduParLineBuffer lines(outStream);
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    AbstractArduPar* par=PAR_SETTINGS_INSTANCES[i];
+    lines.print(F("stats\t"));
+    lines.print(par->cmdString);
+    lines.print(F("\t"));
+    lines.print(par->stats.updates);
+    lines.print(F("\t"));
+    lines.print(par->stats.clamped);
+    lines.print(F("\t"));
+    lines.print(par->stats.parseErrors);
+    lines.print(F("\t"));
+    lines.print(par->stats.eepromBytes);
+    lines.print(F("\t"));
+    lines.print(par->stats.lastUpdateMillis);
+    lines.print(F("\n"));
+  }
+  lines.print(F("timing\t"));
+  lines.print(PAR_SETTINGS_LIBRARY_STATS.parseMicros);
+  lines.print(F("\t"));
+  lines.print(PAR_SETTINGS_LIBRARY_STATS.dispatchMicros);
+  lines.print(F("\t"));
+  lines.print(PAR_SETTINGS_LIBRARY_STATS.eepromMicros);
+  lines.print(F("\t"));
+  lines.print(PAR_SETTINGS_LIBRARY_STATS.unknownCommands);
+  lines.print(F("\n"));
+}
+
+////////////////////
+/// A command that prints the statistics to a stream. "stats 0" also resets them.
+class StatsArduPar:
+public AbstractArduPar{
+public:
+  Stream* outStream;	///< the statistics are printed here
+
+  /// Initialize the command. Has to be called for it to become usable.
+  void setup(
+    const __FlashStringHelper* cmdString,	///< i.e. F("stats")
+    Stream* outStream=&Serial				///< where the statistics go
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    this->outStream=outStream;
+  }
+
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    dumpParameterStats(outStream);
+  }
+#endif
+
+  /// print the statistics, and reset them if the command is followed by a 0
+  virtual void parseParameterString(char* data){
+    dumpParameterStats(outStream);
+    while(*data==' ')data++;
+    if(*data=='0')resetParameterStats();
+  }
+
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    dumpParameterStats(outStream);
+    if((arg->typeTag=='l'||arg->typeTag=='i')&&arg->intValue==0)resetParameterStats();
+  }
+
+  /// give human&machine readably status info
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("trigger\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\n"));
+  }
+};
+
+#endif
@@ -0,0 +1,265 @@
+#pragma once
+// String settings that share one buffer in RAM and one block of eeprom. Included by ArduPar.h.
+//
+// A StringArduPar needs a buffer of maxLength chars and maxLength bytes of eeprom, no matter how long the string is.
+// ArenaStringArduPar settings keep their strings packed in the buffer of an ArduParStringArena instead, each as
+// [length][chars][0], in the order of their setup(). A string takes its length plus 2 bytes, and the arena only has to be as large
+// as all strings together are going to be, not as all of their maximum lengths.
+//
+// When a string changes its length, the strings behind it are moved, so there are never gaps. The eeprom block mirrors the buffer.
+// Only bytes that differ from the eeprom are written, so changing chars without changing the length writes just those chars,
+// while a new length rewrites the moved strings as well. Put strings that change their length often behind the others.
+//
+// The pointer returned by getValue() is valid until the next change of a string in the same arena.
+// Stored strings are checked when they are set up. If one of them does not fit, it and all strings behind it get their defaults.
+// Adding strings behind the existing ones keeps their stored values. Arena strings are not part of parameter images or presets.
+//
+// Example:
+//   uint8_t nameBuffer[48];
+//   ArduParStringArena names;
+//   ArenaStringArduPar ssidSetting;
+//   ArenaStringArduPar hostSetting;
+//   ...
+//   names.setup(nameBuffer,sizeof(nameBuffer));
+//   ssidSetting.setup(F("ssid"),&names,32);
+//   hostSetting.setup(F("host"),&names,32,F("arduino"));
+//   ...
+//   names.dumpFootprint(&Serial);
+
+class ArenaStringArduPar;
+
+////////////////////
+/// RAM and eeprom that ArenaStringArduPar settings keep their strings in, without gaps.
+class ArduParStringArena{
+public:
+  uint8_t* buffer;			///< the strings in RAM
+  int size;					///< bytes at "buffer"
+  int used;					///< bytes taken by the strings that are set up
+  int eepromAdress;			///< adress of the block in eeprom, -1 if the strings are not stored
+  int dirtyStart;			///< first byte that changed since it was written
+  int dirtyEnd;				///< byte after the last one that changed. Equal to dirtyStart if nothing changed.
+  bool storedValid;			///< false after a stored string did not fit. Strings behind it get their defaults.
+  ArenaStringArduPar* first;	///< the strings, in the order they are stored
+  ArenaStringArduPar* last;
+
+  /// set up the arena. Has to be called before the strings that use it are set up.
+  void setup(
+    uint8_t* buffer,				///< RAM for the strings
+    int size,						///< bytes at "buffer"
+    boolean isPersistent=true,		///< should the strings be stored in eeprom?
+    int fixedEEPROMAdress=-1		///< if you want a specific fixed adress, specify it here
+  ){
+    this->buffer=buffer;
+    this->size=size;
+    used=0;
+    dirtyStart=dirtyEnd=0;
+    storedValid=isPersistent;
+    first=last=0;
+    if(!isPersistent){
+      eepromAdress=-1;
+      return;
+    }
+    eepromAdress=(fixedEEPROMAdress==-1)?EepromAdressManager::getAdressFor(size):fixedEEPROMAdress;
+    eeprom_read_block(buffer,(void*)eepromAdress,size);	//checked by the strings when they are set up
+  }
+
+  bool isPersistent(){return eepromAdress>=0;}
+
+  /// offset of the entry of "string" in the buffer
+  int entryOffset(ArenaStringArduPar* string);
+
+  /// Replace the entry at "offset" by "length" chars from "data" ("inProgmem" if they are in flash), moving the entries behind it.
+  /// The string is cut if the arena is full. Returns the number of chars that were taken.
+  int replaceEntry(int offset, const char* data, int length, bool inProgmem=false){
+    int oldFootprint=buffer[offset]+2;
+    length=min(length,size-used+oldFootprint-2);
+    int newFootprint=length+2;
+    memmove(buffer+offset+newFootprint,buffer+offset+oldFootprint,used-offset-oldFootprint);
+    buffer[offset]=length;
+    if(inProgmem)memcpy_P(buffer+offset+1,data,length);
+    else memcpy(buffer+offset+1,data,length);
+    buffer[offset+1+length]=0;
+    used+=newFootprint-oldFootprint;
+    changed(offset,used);
+    return length;
+  }
+
+  /// remember that the bytes from "start" up to "end" (exclusive) have to be written
+  void changed(int start, int end){
+    if(!isPersistent()||start>=end)return;
+    if(dirtyStart==dirtyEnd){
+      dirtyStart=start;
+      dirtyEnd=end;
+    }else{
+      dirtyStart=min(dirtyStart,start);
+      dirtyEnd=max(dirtyEnd,end);
+    }
+  }
+
+  /// write the changed bytes that differ from the eeprom, if "maxBytes" is not 0 (-1 for no limit). Returns the number of bytes written.
+  /// All of them are written at once, even if that takes more than "maxBytes", so a reset never leaves strings that are half moved.
+  int writeChangedBytes(int maxBytes=-1){
+    int written=0;
+    for(;dirtyStart<dirtyEnd;dirtyStart++){
+      uint8_t* adress=(uint8_t*)(eepromAdress+dirtyStart);
+      if(eeprom_read_byte(adress)==buffer[dirtyStart])continue;
+      if(maxBytes==0)return 0;   //budget used up, stay dirty
+      eeprom_write_byte(adress,buffer[dirtyStart]);
+      written++;
+    }
+    dirtyStart=dirtyEnd=0;
+    return written;
+  }
+
+  /// print the bytes each string takes in the arena, and how much of it is used
+  void dumpFootprint(Stream* out);
+};
+
+////////////////////
+/// A string setting that keeps its value in an ArduParStringArena.
+class ArenaStringArduPar:
+public AbstractArduPar{
+public:
+  ArduParStringArena* arena;	///< the arena the string is in, 0 if it was full
+  ArenaStringArduPar* next;		///< the string behind this one in the arena
+  int maxLength;				///< maximum number of chars, including the terminating 0 like for StringArduPar
+
+  /// Initialize the setting. Has to be called for the setting to become usable.
+  void setup(
+    const __FlashStringHelper* cmdString,
+    ArduParStringArena* arena,			///< the arena that holds the string. It decides about persistence.
+    int maxLength,						///< maximum number of chars, including the terminating 0
+    const __FlashStringHelper* defaultValue=0	///< the string if nothing valid is stored
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    this->maxLength=maxLength;
+    this->arena=arena;
+    next=0;
+    if(arena->size-arena->used<2){
+      Serial.print(F("String arena full, could not add "));
+      Serial.println(cmdString);
+      this->arena=0;
+      return;
+    }
+    if(arena->last==0)arena->first=this;
+    else arena->last->next=this;
+    arena->last=this;
+    if(arena->isPersistent())eepromAdress=arena->eepromAdress;	//makes isPersistent() true. The arena does the writing.
+    int offset=arena->used;
+    if(arena->storedValid&&isValidEntry(offset)){
+      arena->used+=arena->buffer[offset]+2;
+    }else{
+      arena->storedValid=false;
+      arena->buffer[offset]=0;
+      arena->used+=2;
+      const char PROGMEM * p=(const char PROGMEM *)defaultValue;
+      if(p==0)p=PSTR("");
+      arena->replaceEntry(offset,p,min((int)strlen_P(p),maxLength-1),true);
+      persistValue();	//store the default, and the entries behind it that moved
+    }
+    TRACE((F(" value:")));
+    TRACELN((getValue()));
+  }
+
+  /// The string. Valid until the next change of a string in the same arena.
+  const char* getValue(){
+    if(arena==0)return "";
+    return (const char*)arena->buffer+arena->entryOffset(this)+1;
+  }
+  /// number of chars in the string
+  int getLength(){return arena==0?0:arena->buffer[arena->entryOffset(this)];}
+  /// bytes the string takes in the arena
+  int getFootprint(){return arena==0?0:getLength()+2;}
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='s')setValue(_mes->getArgStringData(0));
+  };
+#endif
+
+  ///set the string from the remaining data. one leading character after the command name is skipped
+  virtual void parseParameterString(char* data){
+    if(strlen(data)>1)setValue(data+1);
+  };
+
+  ///set the string from a binary argument. Numbers are ignored.
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='s')setValue(arg->stringValue);
+  };
+
+  /// set a new value, cut to maxLength-1 chars or what fits into the arena, and save it
+  void setValue(const char* newValue){
+    if(arena==0)return;
+    valueReceived=true; // flag: I got new data!
+    int length=strlen(newValue);
+    int taken=arena->replaceEntry(arena->entryOffset(this),newValue,min(length,maxLength-1));
+    if(taken<length)valueClamped();
+    TRACE((F("Setting ")));
+    TRACE((this->cmdString));
+    TRACE((F(" to ")));
+    TRACELN((getValue()));
+    persistValue();
+  };
+
+  /// the arena stores the value, so it is not part of images or presets
+  virtual void* getValueData(){return (void*)getValue();}
+  virtual int getValueSize(){return 0;}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='s';arg->stringValue=(char*)getValue();return true;}
+  virtual void storeValue(){}
+  /// write what changed in the arena, which may include other strings
+  virtual int writeChangedBytes(int maxBytes=-1){
+    int written=arena==0?0:arena->writeChangedBytes(maxBytes);
+    valueDirty=arena!=0&&arena->dirtyStart!=arena->dirtyEnd;
+    return written;
+  }
+
+  /// give human&machine readably status info, like a StringArduPar
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("string\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(getValue());
+    out->print(F("\n"));
+  }
+
+private:
+  /// true if a string that fits this setting is stored at "offset"
+  bool isValidEntry(int offset){
+    int length=arena->buffer[offset];
+    if(length>maxLength-1||offset+length+2>arena->size||arena->buffer[offset+1+length]!=0)return false;
+    return memchr(arena->buffer+offset+1,0,length)==0;
+  }
+};
+
+int ArduParStringArena::entryOffset(ArenaStringArduPar* string){
+  int offset=0;
+  for(ArenaStringArduPar* s=first;s!=string;s=s->next)offset+=buffer[offset]+2;
+  return offset;
+}
+
+void ArduParStringArena::dumpFootprint(Stream* out){
+  for(ArenaStringArduPar* s=first;s!=0;s=s->next){
+    out->print(F("arena\t"));
+    out->print(s->cmdString);
+    out->print(F("\t"));
+    out->print(s->getFootprint());
+    out->print(F("\t"));
+    out->print(s->maxLength+1);
+    out->print(F("\n"));
+  }
+  out->print(F("arena\t*\t"));
+  out->print(used);
+  out->print(F("\t"));
+  out->print(size);
+  out->print(F("\n"));
+}
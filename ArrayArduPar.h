@@ -0,0 +1,234 @@
+#pragma once
+// Settings for whole arrays of values. Included by ArduPar.h.
+//
+// An ArrayArduPar<T> covers a buffer of "length" values of type T (uint8_t, int, long or float) with shared bounds.
+// Commands can set a slice of it. The index range is inclusive, values that do not fit into it are ignored:
+//   seq[4..9] 1 0 1 1 0 1   sets elements 4 to 9
+//   seq[3] 7                sets element 3
+//   seq[8..] 1 1            sets elements 8 and 9
+//   seq 1 0 0 1             sets elements 0 to 3
+// A binary frame, or a raw OSC packet handed to dispatchOscPacket(), can load elements with a blob ('b') argument:
+// the index of the first element as a little endian 16 bit number, followed by the raw bytes of the elements.
+// Frames are short, so larger arrays are loaded with several blobs. ArdOSC does not decode blobs, so messages
+// that arrive through an OSCServer can only set all elements to one number. A number sets all elements.
+// Received values are constrained to the bounds before they are converted to T, so they never wrap around.
+//
+// Only the span of elements that changed is written to eeprom, as one block. Arrays always get a fixed eeprom adress, never a place in the parameter log.
+// The array shows up as one entry in dumpParameterInfos(), with all values separated by spaces.
+
+// conversions for value types that only arrays use
+inline const __FlashStringHelper* arduParTypeName(uint8_t*){return F("int");}
+
+// received values are parsed and constrained as a type that holds every value of T and more: long for integers, float for floats
+inline long arduParWideValue(uint8_t value){return value;}
+inline long arduParWideValue(int value){return value;}
+inline long arduParWideValue(long value){return value;}
+inline float arduParWideValue(float value){return value;}
+
+////////////////////
+/// A setting for an array of values of type T with shared bounds and optional eeprom persistency.
+template<typename T> class ArrayArduPar:
+public AbstractArduPar{
+public:
+  typedef decltype(arduParWideValue(T())) WideType;	///< received values are constrained as this type, before they are converted to T
+  T* values;          ///< the array that is set
+  int length;         ///< number of elements
+  T minValue;         ///< lower Bound of all elements
+  T maxValue;         ///< upper Bound of all elements
+  int dirtyStart;     ///< first element that was changed but not written to eeprom yet
+  int dirtyEnd;       ///< element after the last one that was changed. Equal to dirtyStart if nothing is dirty.
+
+  /// set up the setting. has to be called to make it functional
+  void setup(
+	  const __FlashStringHelper* cmdString,
+	  T* values,						///< the array to be set
+	  int length,						///< number of elements in the array
+	  T minValue,
+	  T maxValue,
+	  boolean isPersistent=true,      ///< should the array be initialized from eeprom on startup?
+	int fixedEEPROMAdress=-1		///< if you want a specific fixed adress, specify it here
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	this->values=values;
+	this->length=length;
+	this->minValue=minValue;
+	this->maxValue=maxValue;
+	dirtyStart=dirtyEnd=0;
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+	//the parameter log only takes small values, so arrays always get an adress of their own
+	if(isPersistent&&fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(getValueSize());
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	if(isPersistent)for(int i=0;i<length;i++)values[i]=constrain(values[i],minValue,maxValue);	//erased eeprom gives garbage
+  };
+
+  virtual bool isArray(){return true;}
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='i')fill((WideType)_mes->getArgInt32(0));
+    else if(_mes->getArgTypeTag(0)=='f')fill((WideType)_mes->getArgFloat(0));
+  };
+#endif
+
+  /// set a slice of the array from a string that was received, like "[4..9] 1 0 1 1 0 1"
+  virtual void parseParameterString(char* data){
+    int first=0;
+    int last=length-1;
+    while(*data==' ')data++;
+    if(*data=='['){
+      data++;
+      first=atoi(data);
+      last=first;
+      while(*data>='0'&&*data<='9')data++;
+      if(data[0]=='.'&&data[1]=='.'){
+        data+=2;
+        last=(*data>='0'&&*data<='9')?atoi(data):length-1;
+      }
+      data=strchr(data,']');
+      if(data==0){
+        PAR_STAT(stats.parseErrors++);
+        return;
+      }
+      data++;
+    }
+    last=min(last,length-1);
+    if(first<0||first>last){
+      PAR_STAT(stats.parseErrors++);
+      return;
+    }
+    int index=first;
+    for(;index<=last;index++){
+      while(*data==' ')data++;
+      if(*data<=' ')break;	//no more values
+      WideType newValue;
+      parseArduParValue(data,&newValue);
+      values[index]=constrainValue(newValue);
+      while(*data>' ')data++;
+    }
+    if(index>first)changed(first,index);
+  };
+
+  ///set the array from a binary argument: a blob loads raw elements from the index it starts with, a number sets all elements
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='b'){
+      const uint8_t* data=(const uint8_t*)arg->stringValue;
+      int first=arg->intValue<2?length:data[0]|(data[1]<<8);
+      int count=first<length?min((int)((arg->intValue-2)/sizeof(T)),length-first):0;
+      if(count<=0){
+        PAR_STAT(stats.parseErrors++);
+        return;
+      }
+      memcpy(values+first,data+2,count*sizeof(T));
+      for(int i=first;i<first+count;i++)values[i]=constrain(values[i],minValue,maxValue);
+      changed(first,first+count);
+    }
+    else if(arg->typeTag=='f')fill((WideType)arg->floatValue);
+    else if(arg->typeTag=='i'||arg->typeTag=='l')fill((WideType)arg->intValue);
+  };
+
+  /// set all elements to the same value
+  void fill(WideType newValue){
+    T element=constrainValue(newValue);
+    for(int i=0;i<length;i++)values[i]=element;
+    changed(0,length);
+  }
+
+  /// set one element
+  void setValue(int index, WideType newValue){
+    if(index<0||index>=length)return;
+    values[index]=constrainValue(newValue);
+    changed(index,index+1);
+  }
+
+  /// constrain a received value to the bounds and convert it to T
+  T constrainValue(WideType newValue){
+    if(newValue<minValue||newValue>maxValue)valueClamped();
+    return (T)constrain(newValue,(WideType)minValue,(WideType)maxValue);
+  }
+
+  /// Call this after changing the elements from "first" up to "end" (exclusive) directly, to have them persisted.
+  void changed(int first, int end){
+	valueReceived=true; // flag: I got new data!
+    TRACE((F("Setting ")));
+    TRACE((this->cmdString));
+    TRACE((F(" elements ")));
+    TRACE((first));
+    TRACE((F(" to ")));
+    TRACELN((end-1));
+    if(isPersistent()){
+      if(dirtyStart==dirtyEnd){
+        dirtyStart=first;
+        dirtyEnd=end;
+      }else{
+        dirtyStart=min(dirtyStart,first);
+        dirtyEnd=max(dirtyEnd,end);
+      }
+    }
+    persistValue();
+  }
+
+  virtual void valueLoaded(){
+    for(int i=0;i<length;i++)values[i]=constrain(values[i],minValue,maxValue);
+    changed(0,length);
+  }
+  /// all elements are taken, or none if one of them is out of bounds
+  virtual bool loadValue(const uint8_t* data){
+    for(int i=0;i<length;i++){
+      T element;
+      memcpy(&element,data+i*sizeof(T),sizeof(T));
+      if(!(element>=minValue&&element<=maxValue))return false;
+    }
+    memcpy(values,data,length*sizeof(T));
+    return true;
+  }
+  virtual void* getValueData(){return values;}
+  virtual int getValueSize(){return length*sizeof(T);}
+
+  /// write the span of elements that changed as one block, but no more than "maxBytes" (-1 for no limit)
+  virtual int writeChangedBytes(int maxBytes=-1){
+    int start=dirtyStart*sizeof(T);
+    int size=(dirtyEnd-dirtyStart)*sizeof(T);
+    if(!isPersistent()||size==0){valueDirty=false;return 0;}
+    if(maxBytes>=0&&size>maxBytes){
+      //write as many whole elements as the budget allows and keep the rest dirty.
+      //Like a record of the parameter log, an element is never split, so one may exceed the rest of a budget that is not used up yet.
+      if(maxBytes==0)return 0;
+      int count=max(maxBytes/(int)sizeof(T),1);
+      eeprom_update_block((const uint8_t*)values+start,(void*)(eepromAdress+start),count*sizeof(T));
+      dirtyStart+=count;
+      return count*sizeof(T);
+    }
+    eeprom_update_block((const uint8_t*)values+start,(void*)(eepromAdress+start),size);
+    dirtyStart=dirtyEnd=0;
+    valueDirty=false;
+    return size;
+  }
+
+  /// give human&machine readably status info. All values are in one field, separated by spaces.
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(arduParTypeName((T*)0));
+    out->print(F("["));
+    out->print(length);
+    out->print(F("]\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    for(int i=0;i<length;i++){
+      if(i>0)out->print(F(" "));
+      out->print(values[i]);
+    }
+    out->print(F("\t"));
+    out->print(minValue);
+    out->print(F("\t"));
+    out->print(maxValue);
+    out->print(F("\n"));
+  }
+};
@@ -0,0 +1,338 @@
+#pragma once
+// On/off switches and modes that share bytes. Included by ArduPar.h.
+//
+// An IntArduPar with bounds 0..1 takes an int, bounds and a value pointer in RAM, two bytes of eeprom and a two byte write per toggle.
+// A BoolArduPar takes one bit and an EnumArduPar as few bits as its names need, in the bytes of an ArduParBitField.
+// The field gets one block of eeprom for all of them. Changing a setting only writes the byte its bits are in, and only if it differs.
+// The bits of a setting never span two bytes.
+//
+// Enum names are given as one string in PROGMEM, separated by '|'. Commands can use the names or the index:
+//   mode fast
+//   mode 2
+// Bools understand 1, 0, on, off, true and false. A bool command without a value toggles it.
+//
+// Example:
+//   uint8_t switchBits[2];
+//   ArduParBitField switches;
+//   BoolArduPar ledSetting;
+//   EnumArduPar modeSetting;
+//   ...
+//   switches.setup(switchBits,sizeof(switchBits));
+//   ledSetting.setup(F("led"),&switches);
+//   modeSetting.setup(F("mode"),F("off|slow|fast"),&switches);
+//   ...
+//   if(ledSetting.getValue()&&modeSetting.getValue()==2) ...
+
+////////////////////
+/// A few bytes of RAM and eeprom that BoolArduPar and EnumArduPar settings keep their values in.
+class ArduParBitField{
+public:
+  uint8_t* bits;			///< the bytes in RAM
+  int numBytes;
+  int eepromAdress;		///< adress of the first byte in eeprom, -1 if the values are not stored
+  int nextBit;			///< first bit that was not given to a setting yet
+
+  /// set up the field. Has to be called before the settings that use it are set up.
+  void setup(
+    uint8_t* bits,					///< RAM for the values
+    int numBytes,					///< number of bytes at "bits"
+    boolean isPersistent=true,		///< should the values of all settings in the field be stored in eeprom?
+    int fixedEEPROMAdress=-1		///< if you want a specific fixed adress, specify it here
+  ){
+    this->bits=bits;
+    this->numBytes=numBytes;
+    memset(bits,0,numBytes);
+    nextBit=0;
+    if(!isPersistent)eepromAdress=-1;
+    else eepromAdress=(fixedEEPROMAdress==-1)?EepromAdressManager::getAdressFor(numBytes):fixedEEPROMAdress;
+  }
+
+  /// Reserve "width" bits within one byte. Returns false if the field is full.
+  bool allocate(uint8_t width, uint8_t* byteIndex, uint8_t* shift){
+    if(nextBit%8+width>8)nextBit=(nextBit/8+1)*8;	//start a new byte
+    if(nextBit+width>numBytes*8)return false;
+    *byteIndex=nextBit/8;
+    *shift=nextBit%8;
+    nextBit+=width;
+    return true;
+  }
+};
+
+////////////////////
+/// Common part of settings whose value is a few bits in an ArduParBitField.
+class BitFieldArduPar:
+public AbstractArduPar{
+public:
+  ArduParBitField* field;	///< the field the bits are in, 0 if it was full
+  uint8_t byteIndex;		///< byte of the field the bits are in
+  uint8_t shift;			///< position of the lowest bit in the byte
+  uint8_t width;			///< number of bits
+
+  /// the bits of the value
+  uint8_t getBits(){
+    if(field==0)return 0;
+    return (field->bits[byteIndex]>>shift)&((1<<width)-1);
+  }
+
+  virtual void* getValueData(){return field==0?0:&field->bits[byteIndex];}
+  virtual int getValueSize(){return field==0?0:1;}
+
+  /// take only the own bits of the stored byte, if they are valid
+  virtual bool loadValue(const uint8_t* data){
+    uint8_t stored=(*data>>shift)&((1<<width)-1);
+    if(!isValidBits(stored))return false;
+    putBits(stored);
+    return true;
+  }
+  virtual void valueLoaded(){
+    if(!isValidBits(getBits()))putBits(0);
+    valueReceived=true;
+    persistValue();
+  }
+
+protected:
+  /// reserve bits in "field", set them to "defaultBits" and read them from eeprom. Called by the setup() of derived classes.
+  void setupBits(ArduParBitField* field, uint8_t width, uint8_t defaultBits){
+    this->width=width;
+    this->field=field;
+    if(!field->allocate(width,&byteIndex,&shift)){
+      Serial.print(F("Bit field full, could not add "));
+      Serial.println(cmdString);
+      this->field=0;
+      return;
+    }
+    putBits(defaultBits);
+    if(field->eepromAdress<0)return;
+    eepromAdress=field->eepromAdress+byteIndex;
+    if(isParameterImagePending(eepromAdress))return;	//loadParameterImage() reads and checks it
+    uint8_t stored=eeprom_read_byte((const uint8_t*)eepromAdress);
+    loadValue(&stored);	//keeps the default if the eeprom holds no valid value
+  }
+
+  /// set the bits without persisting them
+  void putBits(uint8_t newBits){
+    if(field==0)return;
+    uint8_t mask=((1<<width)-1)<<shift;
+    field->bits[byteIndex]=(field->bits[byteIndex]&~mask)|((newBits<<shift)&mask);
+  }
+
+  /// set the bits and persist the byte they are in
+  void setBits(uint8_t newBits){
+    if(field==0)return;
+    valueReceived=true; // flag: I got new data!
+    TRACE((F("Setting ")));
+    TRACE((this->cmdString));
+    TRACE((F(" to ")));
+    TRACELN((newBits));
+    putBits(newBits);
+    persistValue();
+  }
+
+  virtual bool isValidBits(uint8_t bits){return true;}
+};
+
+/// true if "data" starts with the whole word "word" from PROGMEM, followed by the end of the string or a space, so "onion" is no "on"
+bool startsWithWord_P(const char* data, const char PROGMEM * word){
+  size_t length=strlen_P(word);
+  return strncmp_P(data,word,length)==0&&(unsigned char)data[length]<=' ';
+}
+
+////////////////////
+/// An on/off setting that takes one bit of an ArduParBitField.
+class BoolArduPar:
+public BitFieldArduPar{
+public:
+  /// set up the setting. has to be called to make it functional
+  void setup(
+    const __FlashStringHelper* cmdString,
+    ArduParBitField* field,			///< the field that holds the value. It decides about persistence.
+    bool defaultValue=false			///< value if nothing valid is stored
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    setupBits(field,1,defaultValue);
+  }
+
+  bool getValue(){return getBits()!=0;}
+  void setValue(bool newValue){setBits(newValue);}
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='i')setValue(_mes->getArgInt32(0)!=0);
+    else if(_mes->getArgTypeTag(0)=='f')setValue(_mes->getArgFloat(0)!=0);
+  };
+#endif
+
+  /// set the value from "1", "0", "on", "off", "true" or "false". Nothing toggles it. Anything else, like "10" or "onion", is a parse error.
+  virtual void parseParameterString(char* data){
+    while(*data==' ')data++;
+    if(*data==0){setValue(!getValue());return;}
+    if(startsWithWord_P(data,PSTR("1"))||startsWithWord_P(data,PSTR("on"))||startsWithWord_P(data,PSTR("true")))setValue(true);
+    else if(startsWithWord_P(data,PSTR("0"))||startsWithWord_P(data,PSTR("off"))||startsWithWord_P(data,PSTR("false")))setValue(false);
+    else{
+      PAR_STAT(stats.parseErrors++);
+      TRACE((F("Not a bool: ")));
+      TRACELN((data));
+    }
+  }
+
+  ///numbers other than 0 are true, strings are parsed
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='s'){
+      char buffer[8];
+      strncpy(buffer,arg->stringValue,sizeof(buffer)-1);
+      buffer[sizeof(buffer)-1]=0;
+      parseParameterString(buffer);
+    }
+    else if(arg->typeTag=='f')setValue(arg->floatValue!=0);
+    else if(arg->typeTag!='t')setValue(arg->intValue!=0);
+  }
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='l';arg->intValue=getValue();return true;}
+
+  /// give human&machine readably status info
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("bool\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(getValue()?1:0);
+    out->print(F("\n"));
+  }
+};
+
+////////////////////
+/// A setting that is one of a few named values, taking as few bits of an ArduParBitField as the names need.
+class EnumArduPar:
+public BitFieldArduPar{
+public:
+  const __FlashStringHelper* names;	///< the names, separated by '|'
+  uint8_t numNames;
+
+  /// set up the setting. has to be called to make it functional
+  void setup(
+    const __FlashStringHelper* cmdString,
+    const __FlashStringHelper* names,	///< the names of the values, separated by '|', like F("off|slow|fast")
+    ArduParBitField* field,				///< the field that holds the value. It decides about persistence.
+    uint8_t defaultValue=0				///< index of the value if nothing valid is stored
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    this->names=names;
+    const char PROGMEM * p=(const char PROGMEM *)names;
+    numNames=1;
+    for(char c;(c=pgm_read_byte(p))!=0;p++)if(c=='|')numNames++;
+    uint8_t bitsNeeded=1;
+    while((1<<bitsNeeded)<numNames)bitsNeeded++;
+    setupBits(field,bitsNeeded,defaultValue<numNames?defaultValue:0);
+  }
+
+  /// index of the current value
+  uint8_t getValue(){return getBits();}
+  /// set the value by its index. Indices that have no name are constrained to the last one.
+  void setValue(int newValue){
+    if(newValue<0||newValue>=numNames)valueClamped();
+    setBits(constrain(newValue,0,numNames-1));
+  }
+
+  /// index of the name that matches the first "length" chars of "name", -1 if there is none
+  int findName(const char* name, int length){
+    const char PROGMEM * p=(const char PROGMEM *)names;
+    for(int index=0;;index++){
+      if(strncmp_P(name,p,length)==0){
+        char end=pgm_read_byte(p+length);
+        if(end=='|'||end==0)return index;
+      }
+      char c;
+      while((c=pgm_read_byte(p))!='|'&&c!=0)p++;
+      if(c==0)return -1;
+      p++;
+    }
+  }
+
+  /// print the name with the given index
+  void printName(Stream* out, uint8_t index){
+    const char PROGMEM * p=(const char PROGMEM *)names;
+    for(char c;(c=pgm_read_byte(p))!=0;p++){
+      if(c=='|'){
+        if(index==0)return;
+        index--;
+      }
+      else if(index==0)out->print(c);
+    }
+  }
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='i')setValue(_mes->getArgInt32(0));
+    else if(_mes->getArgTypeTag(0)=='s'){
+      const char* name=_mes->getArgStringData(0);
+      int index=findName(name,strlen(name));
+      if(index>=0)setValue(index);
+    }
+  };
+#endif
+
+  /// set the value from a name or an index. An index has to be digits only, "2x" is a parse error.
+  virtual void parseParameterString(char* data){
+    while(*data==' ')data++;
+    int length=0;
+    while(data[length]>' ')length++;
+    int index=-1;
+    if(*data>='0'&&*data<='9'){
+      int digits=0;
+      while(data[digits]>='0'&&data[digits]<='9')digits++;
+      if(digits==length)index=atoi(data);
+    }
+    else index=findName(data,length);
+    if(index<0){
+      PAR_STAT(stats.parseErrors++);
+      TRACE((F("Unknown name: ")));
+      TRACELN((data));
+      return;
+    }
+    setValue(index);
+  }
+
+  ///set the value from a name or an index
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='s'){
+      int index=findName(arg->stringValue,strlen(arg->stringValue));
+      if(index>=0)setValue(index);
+      else PAR_STAT(stats.parseErrors++);
+    }
+    else if(arg->typeTag=='f')setValue((int)arg->floatValue);
+    else if(arg->typeTag!='t')setValue(arg->intValue);
+  }
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='l';arg->intValue=getValue();return true;}
+
+  /// give human&machine readably status info. The value is shown by its name, followed by all names.
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("enum\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    printName(out,getValue());
+    out->print(F("\t"));
+    out->print(names);
+    out->print(F("\n"));
+  }
+
+protected:
+  virtual bool isValidBits(uint8_t bits){return bits<numNames;}
+};
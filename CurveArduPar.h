@@ -0,0 +1,269 @@
+#pragma once
+// Piecewise linear curves, e.g. for sensor calibration or response curves. Included by ArduPar.h.
+//
+// A CurveArduPar<NUM_POINTS> holds NUM_POINTS breakpoints (x,y) over a fixed input range [inMin,inMax].
+// The points are kept sorted by x. Inputs left of the first point give its y, inputs right of the last point give its y.
+//
+// Whenever the points change, the curve is sampled into a table of (1<<TABLE_BITS)+2 values at evenly spaced inputs,
+// with a spacing that is a power of two. evaluate() then takes one table lookup and one integer interpolation, with no
+// division and no float math. Corners of the curve that fall between two table entries are cut off, so pick TABLE_BITS
+// large enough for the curve you need. Each step of TABLE_BITS doubles the RAM of the table.
+//
+//   curve 0 0 512 300 1023 1000     sets the points from the start, as x y pairs
+//   curve[1] 600 350                sets point 1
+//   curve[1..2] 600 350 1023 900    sets points 1 and 2
+//
+// OSC messages set the points from the start with pairs of int arguments. A blob loads the raw points from the start.
+// Curves always get a fixed eeprom adress, never a place in the parameter log. Only bytes that differ are written.
+//
+// Example:
+//   CurveArduPar<4> responseSetting;
+//   ...
+//   responseSetting.setup(F("response"),0,1023,0,255);
+//   ...
+//   analogWrite(ledPin,responseSetting.evaluate(analogRead(A0)));
+
+/// one breakpoint of a CurveArduPar
+struct ArduParCurvePoint{
+  int x;
+  int y;
+};
+
+////////////////////
+/// A setting for a piecewise linear curve through NUM_POINTS breakpoints, evaluated through a table of (1<<TABLE_BITS)+2 values.
+template<uint8_t NUM_POINTS, uint8_t TABLE_BITS=5> class CurveArduPar:
+public AbstractArduPar{
+public:
+  ArduParCurvePoint points[NUM_POINTS];	///< the breakpoints, sorted by x
+  int inMin;				///< lowest input. x of all points is constrained to [inMin,inMax]
+  int inMax;				///< highest input
+  int outMin;				///< lowest output. y of all points is constrained to [outMin,outMax]
+  int outMax;				///< highest output
+  uint8_t stepShift;		///< the inputs of two table entries are (1<<stepShift) apart
+  int table[(1<<TABLE_BITS)+2];	///< the curve at inMin+(i<<stepShift). One more entry than needed, so evaluate() can always look at the next one.
+
+  /// Set up the setting. has to be called to make it functional
+  /// Points that are not stored yet lie on a straight line from (inMin,outMin) to (inMax,outMax).
+  void setup(
+	  const __FlashStringHelper* cmdString,
+	  int inMin,						///< lowest input
+	  int inMax,						///< highest input
+	  int outMin,						///< lowest output
+	  int outMax,						///< highest output
+	  boolean isPersistent=true,      ///< should the points be initialized from eeprom on startup?
+	int fixedEEPROMAdress=-1		///< if you want a specific fixed adress, specify it here
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	this->inMin=inMin;
+	this->inMax=inMax;
+	this->outMin=outMin;
+	this->outMax=outMax;
+	stepShift=0;
+	while((((unsigned long)((long)inMax-inMin))>>stepShift)>(1UL<<TABLE_BITS))stepShift++;
+	setDefaultPoints();
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+	//the parameter log only takes small values, so curves always get an adress of their own
+	if(isPersistent&&fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(getValueSize());
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	if(!isValidCurve((const uint8_t*)points))setDefaultPoints();	//erased eeprom gives garbage
+	rebuildTable();
+  };
+
+  virtual bool isArray(){return true;}
+
+  /// The output for "input". Inputs outside of [inMin,inMax] are constrained.
+  int evaluate(int input){
+    unsigned int offset=(unsigned int)constrain(input,inMin,inMax)-(unsigned int)inMin;
+    unsigned int index=offset>>stepShift;
+    unsigned int fraction=offset&((1U<<stepShift)-1);
+    return table[index]+(int)((((long)table[index+1]-table[index])*(long)fraction)>>stepShift);
+  }
+
+  /// Evaluate "count" inputs, e.g. a buffer of ADC samples. "input" and "output" may be the same buffer.
+  void evaluate(const int* input, int* output, int count){
+    for(int i=0;i<count;i++)output[i]=evaluate(input[i]);
+  }
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    int count=min(_mes->getArgsNum()/2,(int)NUM_POINTS);
+    for(int i=0;i<count;i++){
+      if(_mes->getArgTypeTag(2*i)!='i'||_mes->getArgTypeTag(2*i+1)!='i'){
+        PAR_STAT(stats.parseErrors++);
+        count=i;
+        break;
+      }
+      points[i].x=_mes->getArgInt32(2*i);
+      points[i].y=_mes->getArgInt32(2*i+1);
+    }
+    if(count>0)changed();
+  };
+#endif
+
+  /// set points from a string that was received, like "[1..2] 600 350 1023 900"
+  virtual void parseParameterString(char* data){
+    int first=0;
+    int last=NUM_POINTS-1;
+    while(*data==' ')data++;
+    if(*data=='['){
+      data++;
+      first=atoi(data);
+      last=first;
+      while(*data>='0'&&*data<='9')data++;
+      if(data[0]=='.'&&data[1]=='.'){
+        data+=2;
+        last=(*data>='0'&&*data<='9')?atoi(data):NUM_POINTS-1;
+      }
+      data=strchr(data,']');
+      if(data==0){
+        PAR_STAT(stats.parseErrors++);
+        return;
+      }
+      data++;
+    }
+    last=min(last,NUM_POINTS-1);
+    if(first<0||first>last){
+      PAR_STAT(stats.parseErrors++);
+      return;
+    }
+    int index=first;
+    for(;index<=last;index++){
+      int pair[2];
+      uint8_t numbers=0;
+      for(;numbers<2;numbers++){
+        while(*data==' ')data++;
+        if(*data<=' ')break;	//no more values
+        pair[numbers]=atoi(data);
+        while(*data>' ')data++;
+      }
+      if(numbers<2){
+        PAR_STAT(if(numbers==1)stats.parseErrors++);
+        break;
+      }
+      points[index].x=pair[0];
+      points[index].y=pair[1];
+    }
+    if(index>first)changed();
+  };
+
+  ///set the points from a binary argument: a blob loads raw points from the start
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag!='b')return;
+    int count=min((int)(arg->intValue/sizeof(ArduParCurvePoint)),(int)NUM_POINTS);
+    if(count==0)return;
+    memcpy(points,arg->stringValue,count*sizeof(ArduParCurvePoint));
+    changed();
+  };
+
+  /// set one point
+  void setPoint(int index, int x, int y){
+    if(index<0||index>=NUM_POINTS)return;
+    points[index].x=x;
+    points[index].y=y;
+    changed();
+  }
+
+  /// Call this after changing the points directly, to have them checked, sorted, persisted and sampled into the table.
+  void changed(){
+	valueReceived=true; // flag: I got new data!
+    TRACE((F("Setting ")));
+    TRACELN((this->cmdString));
+    constrainPoints();
+    rebuildTable();
+    persistValue();
+  }
+
+  virtual void valueLoaded(){changed();}
+  /// all points are taken, or none if one of them is out of bounds or they are not sorted
+  virtual bool loadValue(const uint8_t* data){
+    if(!isValidCurve(data))return false;
+    memcpy(points,data,sizeof(points));
+    rebuildTable();
+    return true;
+  }
+  virtual void* getValueData(){return points;}
+  virtual int getValueSize(){return sizeof(points);}
+
+  /// give human&machine readably status info. All points are in one field, as x y pairs separated by spaces.
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("curve["));
+    out->print(NUM_POINTS);
+    out->print(F("]\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    for(int i=0;i<NUM_POINTS;i++){
+      if(i>0)out->print(F(" "));
+      out->print(points[i].x);
+      out->print(F(" "));
+      out->print(points[i].y);
+    }
+    out->print(F("\t"));
+    out->print(outMin);
+    out->print(F("\t"));
+    out->print(outMax);
+    out->print(F("\n"));
+  }
+
+private:
+  /// points on a straight line from (inMin,outMin) to (inMax,outMax)
+  void setDefaultPoints(){
+    for(int i=0;i<NUM_POINTS;i++){
+      points[i].x=inMin+((long)inMax-inMin)*i/max(NUM_POINTS-1,1);
+      points[i].y=outMin+((long)outMax-outMin)*i/max(NUM_POINTS-1,1);
+    }
+  }
+
+  /// true if the points at "data" are within the bounds and sorted
+  bool isValidCurve(const uint8_t* data){
+    ArduParCurvePoint point;
+    int lastX=inMin;
+    for(int i=0;i<NUM_POINTS;i++){
+      memcpy(&point,data+i*sizeof(point),sizeof(point));
+      if(point.x<lastX||point.x>inMax||point.y<outMin||point.y>outMax)return false;
+      lastX=point.x;
+    }
+    return true;
+  }
+
+  /// constrain all points to the bounds and sort them by x
+  void constrainPoints(){
+    for(int i=0;i<NUM_POINTS;i++){
+      if(points[i].x<inMin||points[i].x>inMax||points[i].y<outMin||points[i].y>outMax)valueClamped();
+      points[i].x=constrain(points[i].x,inMin,inMax);
+      points[i].y=constrain(points[i].y,outMin,outMax);
+    }
+    //insertion sort, there are only a few points and they are mostly sorted already
+    for(int i=1;i<NUM_POINTS;i++){
+      ArduParCurvePoint point=points[i];
+      int j=i;
+      for(;j>0&&points[j-1].x>point.x;j--)points[j]=points[j-1];
+      points[j]=point;
+    }
+  }
+
+  /// sample the curve at the inputs of the table entries
+  void rebuildTable(){
+    int segment=0;
+    for(int i=0;i<(1<<TABLE_BITS)+2;i++){
+      long x=(long)inMin+((long)i<<stepShift);	//may lie beyond inMax, where the curve is flat
+      while(segment<NUM_POINTS&&points[segment].x<x)segment++;
+      if(segment==0)table[i]=points[0].y;
+      else if(segment==NUM_POINTS)table[i]=points[NUM_POINTS-1].y;
+      else{
+        const ArduParCurvePoint& a=points[segment-1];
+        const ArduParCurvePoint& b=points[segment];
+        //both differences can take 16 bits and a sign, so their product needs more than a long. a.x<x<=b.x, so there is no division by zero
+        table[i]=a.y+(int)(((long long)b.y-a.y)*(x-a.x)/((long)b.x-a.x));
+      }
+    }
+  }
+};
@@ -0,0 +1,201 @@
+#pragma once
+// Values that are computed from settings, like a PWM period from a frequency or filter coefficients from cutoff and Q. Included by ArduPar.h.
+//
+// A DerivedArduPar<T> has a compute function and up to 4 source settings. It is recomputed only after
+// a source changed: a change of a source marks the derived value dirty, and it is computed again when it is read with getValue(),
+// or when updateDerivedParameters() is called, whichever comes first. Sources can be derived values themselves.
+// Sources have to be set up before the values derived from them. Then the order of setup() is an order in which every value
+// comes after its sources, and updateDerivedParameters() gets along with one pass.
+//
+// Derived values can not be set by commands, but they show up in dumpParameterInfos() and have change callbacks like any setting.
+//
+// Example:
+//   float computePeriod(){return 1000000.0/frequencySetting.value;}
+//   DerivedArduPar<float> periodSetting;
+//   ...
+//   frequencySetting.setup(F("freq"),1,20000);
+//   periodSetting.setup(F("period"),computePeriod,&frequencySetting);
+//   ...
+//   updateDerivedParameters();   //in loop(), or just read periodSetting.getValue()
+
+#define PAR_DERIVED_MAX_SOURCES 4	///< sources of one derived value
+
+// maximum number of derived values
+#ifndef PAR_SETTINGS_MAX_DERIVED
+#define PAR_SETTINGS_MAX_DERIVED 8
+#endif
+
+// the value of a derived setting as an argument, for the types it can have
+inline void setArduParArgument(ArduParArgument* arg, int value){arg->typeTag='l';arg->intValue=value;}
+inline void setArduParArgument(ArduParArgument* arg, long value){arg->typeTag='l';arg->intValue=value;}
+inline void setArduParArgument(ArduParArgument* arg, float value){arg->typeTag='f';arg->floatValue=value;}
+
+////////////////////
+/// The part of derived values that does not depend on their type.
+class AbstractDerivedArduPar:
+public AbstractArduPar{
+public:
+  AbstractArduPar* sources[PAR_DERIVED_MAX_SOURCES];	///< the settings the value is computed from, 0 for unused ones
+  bool dirty;			///< a source changed since the value was computed
+
+  /// compute the value if a source changed since the last time. Sources that are dirty themselves are updated first.
+  /// Returns true if the value was computed.
+  bool update(){
+    if(!dirty)return false;
+    for(int i=0;i<PAR_DERIVED_MAX_SOURCES;i++){
+      AbstractDerivedArduPar* source=findDerivedParameter(sources[i]);
+      if(source!=0)source->update();	//the change notifications of the sources mark this value dirty again
+    }
+    dirty=false;
+    if(compute())queueChangeNotification();
+    return true;
+  }
+
+  /// true if "par" is one of the sources
+  bool dependsOn(AbstractArduPar* par){
+    for(int i=0;i<PAR_DERIVED_MAX_SOURCES;i++)if(sources[i]==par)return true;
+    return false;
+  }
+
+  /// the derived value that "par" is, or 0 if it is none
+  static AbstractDerivedArduPar* findDerivedParameter(AbstractArduPar* par);
+
+  /// derived values can not be set
+  virtual void parseParameterString(char* data){
+    PAR_STAT(stats.parseErrors++);
+    Serial.print(F("Read only: "));
+    Serial.println(cmdString);
+  }
+  virtual void setValueFromArgument(ArduParArgument* arg){PAR_STAT(stats.parseErrors++);}
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){PAR_STAT(stats.parseErrors++);}
+#endif
+
+protected:
+  /// take the sources and add the value to the derived values. Called by the setup() of derived classes.
+  void setupSources(AbstractArduPar* source1, AbstractArduPar* source2, AbstractArduPar* source3, AbstractArduPar* source4);
+  /// compute the value. Returns true if it changed.
+  virtual bool compute()=0;
+};
+
+AbstractDerivedArduPar* PAR_SETTINGS_DERIVED[PAR_SETTINGS_MAX_DERIVED];	///< all derived values, each after its sources
+int PAR_SETTINGS_CUR_DERIVED_NUMBER=0;
+
+AbstractDerivedArduPar* AbstractDerivedArduPar::findDerivedParameter(AbstractArduPar* par){
+  if(par==0)return 0;
+  for(int i=0;i<PAR_SETTINGS_CUR_DERIVED_NUMBER;i++)if(PAR_SETTINGS_DERIVED[i]==par)return PAR_SETTINGS_DERIVED[i];
+  return 0;
+}
+
+void AbstractDerivedArduPar::setupSources(AbstractArduPar* source1, AbstractArduPar* source2, AbstractArduPar* source3, AbstractArduPar* source4){
+  sources[0]=source1;
+  sources[1]=source2;
+  sources[2]=source3;
+  sources[3]=source4;
+  dirty=true;
+  if(PAR_SETTINGS_CUR_DERIVED_NUMBER>=PAR_SETTINGS_MAX_DERIVED){
+    Serial.println(F("Max number of derived parameters exceeded"));
+    return;
+  }
+  PAR_SETTINGS_DERIVED[PAR_SETTINGS_CUR_DERIVED_NUMBER++]=this;
+}
+
+/// Mark the values derived from "source" dirty, and the ones derived from them. Called whenever a setting changed.
+void markDerivedParametersDirty(AbstractArduPar* source){
+  //each derived value comes after its sources, so one pass reaches all of them
+  for(int i=0;i<PAR_SETTINGS_CUR_DERIVED_NUMBER;i++){
+    AbstractDerivedArduPar* derived=PAR_SETTINGS_DERIVED[i];
+    if(derived->dirty)continue;
+    for(int j=0;j<PAR_DERIVED_MAX_SOURCES&&!derived->dirty;j++){
+      AbstractArduPar* par=derived->sources[j];
+      if(par==0)continue;
+      if(par==source)derived->dirty=true;
+      else{
+        AbstractDerivedArduPar* sourceDerived=AbstractDerivedArduPar::findDerivedParameter(par);
+        if(sourceDerived!=0&&sourceDerived->dirty)derived->dirty=true;
+      }
+    }
+  }
+}
+
+/// Compute all derived values whose sources changed, each once, after its sources. Call this in loop() at a point where
+/// your code can take the time, or read the values with getValue() to compute them when they are needed.
+/// Returns the number of values that were computed.
+int updateDerivedParameters(){
+  int computed=0;
+  for(int i=0;i<PAR_SETTINGS_CUR_DERIVED_NUMBER;i++){
+    if(PAR_SETTINGS_DERIVED[i]->update())computed++;
+  }
+  return computed;
+}
+
+////////////////////
+/// A value of type T (int, long or float) that is computed from other settings.
+template<typename T> class DerivedArduPar:
+public AbstractDerivedArduPar{
+public:
+  T value;			///< the value as it was computed last. Use getValue() to have it computed if a source changed.
+  T (*computeFunction)();	///< computes the value from the sources
+
+  DerivedArduPar():
+  value(0)
+  {
+  }
+
+  /// set up the value. Has to be called after the setup() of all sources.
+  void setup(
+    const __FlashStringHelper* cmdString,
+    T (*computeFunction)(),			///< computes the value, i.e. by reading the values of the sources
+    AbstractArduPar* source1,			///< a setting the value depends on
+    AbstractArduPar* source2=0,		///< more settings the value depends on
+    AbstractArduPar* source3=0,
+    AbstractArduPar* source4=0
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+    this->computeFunction=computeFunction;
+    setupSources(source1,source2,source3,source4);
+    update();
+  }
+
+  /// the value, computed now if a source changed since the last time
+  T getValue(){
+    update();
+    return value;
+  }
+
+  virtual void* getValueData(){return &value;}
+  virtual int getValueSize(){return sizeof(value);}
+  virtual bool getValueArgument(ArduParArgument* arg){setArduParArgument(arg,getValue());return true;}
+
+  /// give human&machine readably status info. The value is computed first, if a source changed.
+  virtual void dumpParameterInfo(Stream* out){
+    out->print(F("derived\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(getValue());
+    out->print(F("\t"));
+    out->print(arduParTypeName((T*)0));
+    out->print(F("\n"));
+  }
+
+protected:
+  virtual bool compute(){
+    T newValue=computeFunction();
+    if(newValue==value)return false;
+    TRACE((F("Computed ")));
+    TRACE((this->cmdString));
+    TRACE((F(": ")));
+    TRACELN((newValue));
+    value=newValue;
+    return true;
+  }
+};
@@ -0,0 +1,238 @@
+#pragma once
+// Fixed point settings. Included by ArduPar.h.
+//
+// A FixedArduPar stores its value as an integer with FRACTION_BITS binary digits after the point,
+// i.e. FixedArduPar<int16_t,8> holds Q8.8 values and FixedArduPar<long,16> holds Q16.16 values.
+// Received decimals like "-1.25" are converted with integer arithmetic only, without atof(). The float library is still linked,
+// since floats from binary frames and OSC messages are converted as well, and getValueArgument() gives the value as a float.
+// The value can be used directly in fixed point DSP or control code, without a conversion on every iteration.
+//
+// Example:
+//   FixedArduPar<long,16> gainSetting;
+//   gainSetting.setup(F("gain"),FIXED_POINT(-2.5,16),FIXED_POINT(2.5,16));
+//   ...
+//   long output=(input*gainSetting.value)>>16;
+
+/// convert a constant to fixed point with the given number of fraction bits. The compiler does this at compile time for constants.
+#define FIXED_POINT(value,fractionBits) ((long)((value)*(1L<<(fractionBits))+((value)<0?-0.5:0.5)))
+
+/// Parse a decimal number like "-12.375" into a fixed point value with "fractionBits" bits after the point, without using floats.
+/// Fraction digits are rounded to the nearest representable value. Integer parts that do not fit are saturated.
+long parseFixedPoint(const char* data, uint8_t fractionBits){
+  while(*data==' ')data++;
+  bool negative=false;
+  if(*data=='-'||*data=='+'){
+    negative=(*data=='-');
+    data++;
+  }
+  const unsigned long integerLimit=(1UL<<(31-fractionBits))-1;
+  unsigned long integerPart=0;
+  while(*data>='0'&&*data<='9'){
+    integerPart=integerPart*10+(*data-'0');
+    if(integerPart>integerLimit)integerPart=integerLimit;
+    data++;
+  }
+  //the fraction is built from its last digit to its first: f=(f+digit)/10, with one extra bit for rounding
+  unsigned long fraction=0;
+  if(*data=='.'){
+    const char* firstDigit=++data;
+    while(*data>='0'&&*data<='9')data++;
+    if(data-firstDigit>9)data=firstDigit+9;	//more digits would not change the result
+    for(const char* digit=data-1;digit>=firstDigit;digit--){
+      fraction=(fraction+((unsigned long)(*digit-'0')<<(fractionBits+1)))/10;
+    }
+    fraction=(fraction+1)>>1;
+  }
+  unsigned long magnitude=(integerPart<<fractionBits)+fraction;
+  if(magnitude>0x7FFFFFFFUL)magnitude=0x7FFFFFFFUL;
+  return negative?-(long)magnitude:(long)magnitude;
+}
+
+/// bytes formatFixedPoint() needs for a value of "valueBits" bits, sign included, with "fractionBits" bits after the point:
+/// the integer digits, the fraction digits, sign, point and terminating 0
+#define FIXED_POINT_TEXT_SIZE(valueBits,fractionBits) (((valueBits)-1-(fractionBits))*3/10+1+((fractionBits)*3+9)/10+3)
+
+/// Write a fixed point value as a decimal into "buffer", with as many fraction digits as the fraction bits can resolve.
+/// Trailing zeros are left out. "buffer" needs FIXED_POINT_TEXT_SIZE(bits of the value,fractionBits) bytes. Returns "buffer".
+char* formatFixedPoint(char* buffer, long value, uint8_t fractionBits){
+  char* out=buffer;
+  unsigned long magnitude=value<0?-(unsigned long)value:(unsigned long)value;
+  unsigned long fractionMask=(1UL<<fractionBits)-1;
+  unsigned long integerPart=magnitude>>fractionBits;
+  unsigned long fraction=magnitude&fractionMask;
+  //one decimal digit resolves log2(10) bits
+  uint8_t numDigits=(fractionBits*3+9)/10;
+  char digits[11];	//up to 10 digits for 31 fraction bits, and one to round on
+  for(uint8_t i=0;i<=numDigits;i++){
+    fraction*=10;
+    digits[i]=(char)(fraction>>fractionBits);
+    fraction&=fractionMask;
+  }
+  //round on the digit after the last one
+  bool carry=digits[numDigits]>=5;
+  for(int i=numDigits-1;i>=0&&carry;i--){
+    digits[i]++;
+    carry=digits[i]>9;
+    if(carry)digits[i]=0;
+  }
+  if(carry)integerPart++;
+  while(numDigits>0&&digits[numDigits-1]==0)numDigits--;
+  if(value<0&&(integerPart>0||numDigits>0))*out++='-';
+  ultoa(integerPart,out,10);
+  out+=strlen(out);
+  if(numDigits>0){
+    *out++='.';
+    for(uint8_t i=0;i<numDigits;i++)*out++='0'+digits[i];
+  }
+  *out=0;
+  return buffer;
+}
+
+////////////////////
+/// A setting that holds a fixed point number of type T (int16_t, int or long) with FRACTION_BITS bits after the point.
+/// Bounds and value are in the same fixed point format. Use FIXED_POINT() to give them as decimals.
+template<typename T, uint8_t FRACTION_BITS> class FixedArduPar:
+public AbstractArduPar{
+  //parseFixedPoint() shifts a decimal digit by FRACTION_BITS+1 in 32 bits, and the value needs an integer bit and a sign
+  static_assert(FRACTION_BITS<=27,"FixedArduPar supports at most 27 fraction bits");
+  static_assert(FRACTION_BITS<sizeof(T)*8-1,"FixedArduPar needs more bits in T than FRACTION_BITS");
+public:
+  T value;
+  T* valuePointer;   ///< points to the parameter value to be set
+  T minValue;        ///< lower Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
+  T maxValue;        ///< upper Bound of the Parameter. Received values are constrained to be in the Range of [minValue,maxValue]
+
+  ///simplest possible constructor, will use own value and no persistency
+  FixedArduPar():
+  value(0),
+  valuePointer(&this->value)
+  {
+  }
+  /// set up the setting. has to be called to make it functional
+  void setup(
+	  const __FlashStringHelper* cmdString,
+	  T minValue,						///< lowest value, in fixed point
+	  T maxValue,						///< highest value, in fixed point
+	  boolean isPersistent=true,      ///< should the parameter value be initialized from eeprom on startup?
+    T* valuePointer=0,			///< the setting can modify an arbitrary location im memory if you give it here.
+	int fixedEEPROMAdress=-1		///< if you want a specific fixed adress, specify it here
+	#ifdef USE_OSC
+	  ,OSCServer *server=globalArduParOscServer
+	#endif
+  ){
+  if(valuePointer==0)valuePointer=&this->value;
+	this->valuePointer=valuePointer;
+	this->minValue=minValue;
+	this->maxValue=maxValue;
+	#ifdef USE_OSC
+		AbstractArduPar::setup(cmdString,server);
+	#else
+		AbstractArduPar::setup(cmdString);
+	#endif
+	setupPersistence(isPersistent,fixedEEPROMAdress);
+	TRACE((F(" value:")));
+	TRACELN((*valuePointer));
+  };
+
+  //optional osc support
+#ifdef USE_OSC
+  virtual void applyOscMessage(OSCMessage *_mes){
+    if(_mes->getArgTypeTag(0)=='i'){
+      setWholeValue(_mes->getArgInt32(0));
+    }
+    else{
+      if(_mes->getArgTypeTag(0)=='f'){
+        setFloatValue(_mes->getArgFloat(0));
+      }
+    }
+  };
+#endif
+
+  ///set the attached parameter from a decimal string that was received
+  virtual void parseParameterString(char* data){
+    PAR_STAT(if(!isNumberText(data))stats.parseErrors++);
+    setFixedValue(parseFixedPoint(data,FRACTION_BITS));
+  };
+
+  ///set the attached parameter from a binary argument. Integers are whole numbers, not fixed point.
+  virtual void setValueFromArgument(ArduParArgument* arg){
+    if(arg->typeTag=='f')setFloatValue(arg->floatValue);
+    else if(arg->typeTag=='s')setFixedValue(parseFixedPoint(arg->stringValue,FRACTION_BITS));
+    else setWholeValue(arg->asLong());
+  };
+
+  /// set the value from a whole number. It is limited to the bounds before it is shifted, so large numbers can not overflow.
+  void setWholeValue(long whole){
+    if(whole<((long)minValue>>FRACTION_BITS))setBound(minValue);
+    else if(whole>((long)maxValue>>FRACTION_BITS))setBound(maxValue);
+    else setFixedValue(whole*(1L<<FRACTION_BITS));
+  }
+
+  /// set the value from a float. Like for whole numbers, it is limited to the bounds before it is converted.
+  /// NaN is no value at all and is refused as a parse error.
+  void setFloatValue(float newValue){
+    if(!(newValue==newValue)){
+      PAR_STAT(stats.parseErrors++);
+      return;
+    }
+    float scaled=newValue*(1L<<FRACTION_BITS);
+    if(scaled<=(float)minValue)setBound(minValue);
+    else if(scaled>=(float)maxValue)setBound(maxValue);
+    else setFixedValue((long)scaled);
+  }
+
+  /// set the value from a fixed point long, which may be outside of the range of T
+  void setFixedValue(long newValue){
+    if(newValue<minValue||newValue>maxValue)valueClamped();
+    setValue((T)constrain(newValue,(long)minValue,(long)maxValue));
+  }
+
+  //set the value and print some debug info
+  void setValue(T newValue){
+	valueReceived=true; // flag: I got new data!
+    if(newValue<minValue||newValue>maxValue)valueClamped();
+    newValue=constrain(newValue,minValue,maxValue);
+    TRACE((F("Setting ")));
+    TRACE((this->cmdString));
+    TRACE((F(" to ")));
+    TRACELN((newValue));
+    *valuePointer=newValue;
+    //save the new value
+    persistValue();
+  };
+  virtual void* getValueData(){return valuePointer;}
+  virtual int getValueSize(){return sizeof(*valuePointer);}
+  virtual bool getValueArgument(ArduParArgument* arg){arg->typeTag='f';arg->floatValue=(float)*valuePointer/(1L<<FRACTION_BITS);return true;}
+  virtual bool loadValue(const uint8_t* data){return loadBoundedValue(data,valuePointer,minValue,maxValue);}
+  virtual void valueLoaded(){setValue(*valuePointer);}
+  virtual bool interpolateValue(const void* from, const void* to, uint16_t fraction){
+    T a,b;
+    memcpy(&a,from,sizeof(a));
+    memcpy(&b,to,sizeof(b));
+    long difference=(long)b-a;
+    *valuePointer=a+(T)((difference/256)*fraction+(difference%256)*(long)fraction/256);
+    return true;
+  }
+  /// give human&machine readably status info. The value is shown as a decimal, like a FloatArduPar.
+  virtual void dumpParameterInfo(Stream* out){
+    char number[FIXED_POINT_TEXT_SIZE(sizeof(T)*8,FRACTION_BITS)];
+    out->print(F("float\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(this->cmdString);
+    out->print(F("\t"));
+    out->print(formatFixedPoint(number,*valuePointer,FRACTION_BITS));
+    out->print(F("\t"));
+    out->print(formatFixedPoint(number,minValue,FRACTION_BITS));
+    out->print(F("\t"));
+    out->print(formatFixedPoint(number,maxValue,FRACTION_BITS));
+    out->print(F("\n"));
+  }
+
+private:
+  /// set the value to one of the bounds, for a number that was out of them
+  void setBound(T bound){
+    valueClamped();
+    setValue(bound);
+  }
+};
@@ -0,0 +1,233 @@
+#pragma once
+// Settings whose configuration lives in program memory. Included by ArduPar.h.
+//
+// Every IntArduPar, LongArduPar or FloatArduPar keeps its name pointer, bounds, eeprom adress, flags and a vtable pointer in RAM.
+// A TableArduPar holds a whole list of settings of the same type, described by an array of ArduParDescriptor in PROGMEM.
+// Per setting, only the value itself stays in RAM, plus one bit to remember unsaved changes.
+// On an ATmega328P, an IntArduPar costs 31 bytes of RAM (27 for the object, 2 in PAR_SETTINGS_INSTANCES, 2 in the index),
+// without OSC and statistics. 8 of the 27 bytes are the change callback, change group and change tracking flags.
+// An int in a table costs 2 bytes for the value and 1 bit. The table itself costs about 40 bytes, regardless of its length.
+//
+// The names have to be sorted alphabetically (as by strcmp), so they can be found by binary search without an index in RAM.
+// Table entries can be set by serial commands, also in batches, and they show up in dumpParameterInfos().
+// They can not be set by binary frames or OSC, and they are not stored in the parameter log, but in a block of eeprom that belongs to the table.
+// Change callbacks (see AbstractArduPar::onChange()) are called for the table as a whole, not for single entries.
+//
+// Example:
+//   int speed; int accel; long steps;
+//   const char accelName[] PROGMEM="accel";
+//   const char speedName[] PROGMEM="speed";
+//   const ArduParDescriptor<int> motorDescriptors[] PROGMEM={
+//     {accelName,&accel,0,100,true},
+//     {speedName,&speed,0,1000,true},
+//   };
+//   TableArduPar<int,2> motorSettings;
+//   ...
+//   motorSettings.setup(F("motor"),motorDescriptors);
+
+/// The description of one setting in a TableArduPar. Arrays of these are meant to be in PROGMEM.
+template<typename T> struct ArduParDescriptor{
+  const char* cmdString;  ///< points to the name of the setting in PROGMEM
+  T* valuePointer;        ///< the variable that holds the value
+  T minValue;             ///< lower Bound of the Parameter
+  T maxValue;             ///< upper Bound of the Parameter
+  bool isPersistent;      ///< should the value be stored in eeprom?
+};
+
+// conversions for the value types a table can have
+inline void parseArduParValue(const char* data, int* value){*value=atoi(data);}
+inline void parseArduParValue(const char* data, long* value){*value=atol(data);}
+inline void parseArduParValue(const char* data, float* value){*value=atof(data);}
+inline const __FlashStringHelper* arduParTypeName(int*){return F("int");}
+inline const __FlashStringHelper* arduParTypeName(long*){return F("int");}
+inline const __FlashStringHelper* arduParTypeName(float*){return F("float");}
+
+/// compare two strings that are both in program memory, like strcmp
+int comparePgmStrings(const char PROGMEM * a, const char PROGMEM * b){
+  uint8_t ca,cb;
+  do{
+    ca=pgm_read_byte(a++);
+    cb=pgm_read_byte(b++);
+  }while(ca==cb&&ca!=0);
+  return (int)ca-(int)cb;
+}
+
+////////////////////
+/// A list of N settings of type T (int, long or float) that are described by a table of ArduParDescriptor in PROGMEM.
+/// The setting itself acts as whichever entry was selected last. Commands select an entry by its name.
+template<typename T, int N> class TableArduPar:
+public AbstractArduPar{
+public:
+  const __FlashStringHelper* tableName;     ///< name of the table. cmdString is the name of the selected entry, this one otherwise.
+  const ArduParDescriptor<T>* descriptors;  ///< the table in PROGMEM
+  ArduParDescriptor<T> current;             ///< RAM copy of the descriptor of the selected entry
+  int selected;                             ///< index of the selected entry, -1 if none
+  int firstEepromAdress;                    ///< eeprom adress of the first entry. Each entry has its slot, persistent or not.
+  uint8_t dirtyEntries[(N+7)/8];            ///< one bit per entry that was changed but not written to eeprom yet
+
+  /// Initialize the table. Has to be called for the settings to become usable.
+  void setup(
+    const __FlashStringHelper* tableName,		///< name of the table, used in messages
+    const ArduParDescriptor<T>* descriptors,	///< N descriptors in PROGMEM, sorted by name
+    int fixedEEPROMAdress=-1					///< if you want a specific fixed adress for the table's eeprom block, specify it here
+  ){
+    #ifdef USE_OSC
+      AbstractArduPar::setup(tableName,0);
+    #else
+      AbstractArduPar::setup(tableName);
+    #endif
+    this->tableName=tableName;
+    this->descriptors=descriptors;
+    selected=-1;
+    memset(dirtyEntries,0,sizeof(dirtyEntries));
+    if(PAR_SETTINGS_CUR_TABLE_NUMBER<PAR_SETTINGS_MAX_TABLES){
+      PAR_SETTINGS_TABLES[PAR_SETTINGS_CUR_TABLE_NUMBER]=this;
+      PAR_SETTINGS_CUR_TABLE_NUMBER++;
+    }else{
+      Serial.print(F("Max tables exceeded, could not register"));
+      Serial.println(tableName);
+    }
+    //reserve an eeprom slot for every entry and read the persistent ones
+    bool anyPersistent=false;
+    for(int i=0;i<N;i++)if(pgm_read_byte(&descriptors[i].isPersistent))anyPersistent=true;
+    if(anyPersistent&&fixedEEPROMAdress==-1)fixedEEPROMAdress=EepromAdressManager::getAdressFor(N*sizeof(T));
+    firstEepromAdress=anyPersistent?fixedEEPROMAdress:-1;
+    for(int i=0;i<N;i++){
+      selectIndex(i);
+      if(i>0&&comparePgmStrings((const char PROGMEM *)pgm_read_ptr(&descriptors[i-1].cmdString),current.cmdString)>=0){
+        Serial.print(F("Table not sorted by name at "));
+        Serial.println(cmdString);
+      }
+      if(eepromAdress>=0&&!isParameterImagePending(eepromAdress))eeprom_read_block(current.valuePointer,(void *) eepromAdress,sizeof(T));
+    }
+    deselect();
+  }
+
+  virtual bool isTable(){return true;}
+
+  /// binary search for the entry with the given name
+  virtual bool selectEntry(const char* name, int length){
+    int low=0;
+    int high=N-1;
+    while(low<=high){
+      int middle=(low+high)/2;
+      const char PROGMEM * entryName=(const char PROGMEM *)pgm_read_ptr(&descriptors[middle].cmdString);
+      int order=strncmp_P(name,entryName,length);
+      if(order==0&&pgm_read_byte(entryName+length)!=0)order=-1; //name is only a prefix of the entry name
+      if(order==0){
+        selectIndex(middle);
+        return true;
+      }
+      if(order<0)high=middle-1;
+      else low=middle+1;
+    }
+    return false;
+  }
+
+  /// make the entry with the given index the current one
+  void selectIndex(int index){
+    selected=index;
+    memcpy_P(&current,&descriptors[index],sizeof(current));
+    cmdString=(const __FlashStringHelper*)current.cmdString;
+    cmdStringLength=strlen_P(current.cmdString);
+    eepromAdress=(current.isPersistent&&firstEepromAdress>=0)?firstEepromAdress+index*(int)sizeof(T):-1;
+  }
+
+  /// forget the current entry, so that updates that did not select one by name are ignored. The table gets its own name back.
+  void deselect(){
+    selected=-1;
+    eepromAdress=-1;
+    cmdString=tableName;
+    cmdStringLength=strlen_P((const char PROGMEM *)tableName);
+  }
+
+  /// set the selected entry from a string that was received
+  virtual void parseParameterString(char* data){
+    if(selected<0)return;
+    T newValue;
+    parseArduParValue(data,&newValue);
+    setValue(newValue);
+    deselect();
+  }
+
+  /// set the selected entry, constrained to its bounds
+  void setValue(T newValue){
+    if(selected<0)return;
+    valueReceived=true; // flag: I got new data!
+    if(newValue<current.minValue||newValue>current.maxValue)valueClamped();
+    newValue=constrain(newValue,current.minValue,current.maxValue);
+    TRACE((F("Setting ")));
+    TRACE((this->cmdString));
+    TRACE((F(" to ")));
+    TRACELN((newValue));
+    *current.valuePointer=newValue;
+    if(eepromAdress>=0)dirtyEntries[selected/8]|=1<<(selected%8);
+    persistValue();
+  }
+
+  virtual int getStorageAdress(){return firstEepromAdress;}
+  virtual int getStorageSize(){return firstEepromAdress<0?0:N*sizeof(T);}
+
+  /// take the stored entries that are persistent and within their bounds. Returns false if one of them was not.
+  virtual bool loadValue(const uint8_t* data){
+    bool allValid=true;
+    for(int i=0;i<N;i++){
+      selectIndex(i);
+      if(eepromAdress<0)continue;
+      if(!loadBoundedValue(data+i*sizeof(T),current.valuePointer,current.minValue,current.maxValue))allValid=false;
+    }
+    deselect();
+    return allValid;
+  }
+
+  /// write all persistent entries
+  virtual void storeValue(){
+    for(int i=0;i<N;i++){
+      selectIndex(i);
+      if(eepromAdress>=0)eeprom_update_block(current.valuePointer,(void*)eepromAdress,sizeof(T));
+    }
+    deselect();
+  }
+
+  virtual void* getValueData(){return selected<0?0:current.valuePointer;}
+  virtual int getValueSize(){return selected<0?0:sizeof(T);}
+
+  /// write all entries that were changed
+  virtual int writeChangedBytes(int maxBytes=-1){
+    int written=0;
+    for(int i=0;i<N;i++){
+      if((dirtyEntries[i/8]&(1<<(i%8)))==0)continue;
+      selectIndex(i);
+      valueDirty=true;
+      written+=AbstractArduPar::writeChangedBytes(maxBytes<0?-1:max(maxBytes-written,0));
+      if(valueDirty){   //budget used up
+        deselect();
+        return written;
+      }
+      dirtyEntries[i/8]&=~(1<<(i%8));
+    }
+    deselect();
+    valueDirty=false;
+    return written;
+  }
+
+  /// give human&machine readably status info for all entries
+  virtual void dumpParameterInfo(Stream* out){
+    for(int i=0;i<N;i++){
+      selectIndex(i);
+      out->print(arduParTypeName((T*)0));
+      out->print(F("\t"));
+      out->print(this->cmdString);
+      out->print(F("\t"));
+      out->print(this->cmdString);
+      out->print(F("\t"));
+      out->print(*current.valuePointer);
+      out->print(F("\t"));
+      out->print(current.minValue);
+      out->print(F("\t"));
+      out->print(current.maxValue);
+      out->print(F("\n"));
+    }
+    deselect();
+  }
+};
@@ -0,0 +1,50 @@
+// Shows how to react to new values without checking every setting in every loop.
+// A setting can call a function when its value changed. The calls do not happen while the command is parsed,
+// but when dispatchParameterChanges() is called, once per setting, with the final value.
+// Settings that belong together can share a change group, whose function is called once if any of them changed.
+//
+// This example code is in the public domain.
+
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+IntArduPar brightnessSetting;
+IntArduPar redSetting;
+IntArduPar greenSetting;
+IntArduPar blueSetting;
+
+void brightnessChanged(AbstractArduPar* setting){
+  analogWrite(9,brightnessSetting.value);
+}
+
+void colorChanged(){
+  // called once, even if "red 10;green 20;blue 30" changed all three
+  Serial.print("new color: ");
+  Serial.print(redSetting.value);
+  Serial.print(",");
+  Serial.print(greenSetting.value);
+  Serial.print(",");
+  Serial.println(blueSetting.value);
+}
+ArduParChangeGroup colorGroup={colorChanged,false};
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+
+  brightnessSetting.setup(F("brightness"),0,255);
+  brightnessSetting.onChange(brightnessChanged);
+
+  redSetting.setup(F("red"),0,255);
+  greenSetting.setup(F("green"),0,255);
+  blueSetting.setup(F("blue"),0,255);
+  redSetting.setChangeGroup(&colorGroup);
+  greenSetting.setChangeGroup(&colorGroup);
+  blueSetting.setChangeGroup(&colorGroup);
+}
+
+void loop(){
+  //Enter i.e. "brightness 10" into the serial monitor to set the parameter to a new value.
+  updateParametersFromStream(&Serial,10);
+  // the callbacks of the settings that changed are called here
+  dispatchParameterChanges();
+}
@@ -0,0 +1,44 @@
+// Shows how to keep fast changing settings from wearing out the EEPROM.
+// Normally, every value that is received is written to EEPROM right away. This blocks for about 3.3ms per byte
+// and an EEPROM cell only survives about 100000 writes - a fader that sends 50 values per second will kill it within weeks.
+// With deferred persistence, receiving a value only changes RAM. commitParameters() writes the values that
+// really changed, no more often than every "minCommitInterval" ms and no more than "maxBytesPerCommit" bytes per call.
+//
+// This example code is in the public domain.
+
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+IntArduPar brightnessSetting;
+CallbackArduPar saveCallback;  // Type "save" to write everything to EEPROM right now.
+
+void save(){
+  flushParameters();	// writes all changed values immediately. Use this before powering down.
+}
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+  pinMode(13,OUTPUT);  //use the LED Pin as an example output.
+
+  PAR_SETTINGS_PERSISTENCE.deferred=true;            // only mark changed values, don't write them right away
+  PAR_SETTINGS_PERSISTENCE.minCommitInterval=5000;   // write to EEPROM at most every 5 seconds...
+  PAR_SETTINGS_PERSISTENCE.maxBytesPerCommit=2;      // ...and no more than two bytes at a time, so loop() is never stalled for long.
+
+  brightnessSetting.setup(
+    F("brightness"),         // The command used to change the parameter.
+    0,                       // The lowest value the parameter can have.
+    255                      // The highest value the parameter can have.
+  );
+  saveCallback.setup(
+    F("save"),
+    &save
+  );
+}
+
+void loop(){
+  //Enter i.e. "brightness 10" into the serial monitor to set the parameter to a new value.
+  updateParametersFromStream(&Serial,10);
+  commitParameters();  // write changed values to EEPROM when it is time to do so
+
+  analogWrite(13,brightnessSetting.value);
+}
@@ -0,0 +1,42 @@
+// Shows how to keep settings in a wear leveled log in EEPROM.
+// Normally, each setting gets a fixed EEPROM adress in the order of the setup() calls. If you add, remove or reorder settings,
+// they will read each others old values. With beginParameterLog(), values are stored together with a hash of their name instead,
+// so they stay where they belong. Every change appends a small record to a log that wanders through the whole EEPROM,
+// which spreads the wear over all cells instead of rewriting the same ones all the time.
+//
+// This example code is in the public domain.
+
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+IntArduPar speedSetting;
+FloatArduPar gainSetting;
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+
+  beginParameterLog();  // has to be called before the settings are set up. Uses all EEPROM that is still free.
+
+  // Try swapping these two or adding another setting: the values will still be there after a reset.
+  speedSetting.setup(
+    F("speed"),              // The command used to change the parameter. It is also the key for the value in EEPROM.
+    0,                       // The lowest value the parameter can have.
+    1000                     // The highest value the parameter can have.
+  );
+  gainSetting.setup(
+    F("gain"),
+    0,
+    10
+  );
+}
+
+void loop(){
+  //Enter i.e. "speed 10" into the serial monitor to set the parameter to a new value.
+  updateParametersFromStream(&Serial,10);
+
+  Serial.print("speed: ");
+  Serial.print(speedSetting.value);
+  Serial.print("\tgain: ");
+  Serial.println(gainSetting.value);
+  delay(200);
+}
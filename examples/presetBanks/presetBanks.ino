@@ -0,0 +1,40 @@
+// Shows how to switch between scenes with preset banks.
+// "preset store 2" copies all persistent settings into slot 2 of the eeprom, "preset recall 2" loads them again, all at once.
+// "preset recall 2 3000" fades the numeric settings to slot 2 within 3 seconds. The fade is moved on by presets.update() in loop().
+//
+// This example code is in the public domain.
+
+// RAM for the start values of a fade, 16 bytes if you leave this out. Has to be defined before ArduPar.h is included.
+#define PAR_SETTINGS_PRESET_FADE_BUFFER_SIZE 16
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+IntArduPar brightnessSetting;
+IntArduPar hueSetting;
+FloatArduPar speedSetting;
+PresetBankArduPar presets;
+
+void sceneChanged(){
+  analogWrite(9,brightnessSetting.value);
+}
+ArduParChangeGroup sceneGroup={sceneChanged,false};
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+
+  brightnessSetting.setup(F("brightness"),0,255);
+  hueSetting.setup(F("hue"),0,359);
+  speedSetting.setup(F("speed"),0,10);
+  brightnessSetting.setChangeGroup(&sceneGroup);
+  hueSetting.setChangeGroup(&sceneGroup);
+  speedSetting.setChangeGroup(&sceneGroup);
+
+  // has to come after the settings that are part of the presets
+  presets.setup(F("preset"),4);
+}
+
+void loop(){
+  updateParametersFromStream(&Serial,10);
+  presets.update();
+  dispatchParameterChanges();
+}
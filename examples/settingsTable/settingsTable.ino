@@ -0,0 +1,44 @@
+// Shows how to keep the description of many settings in program memory instead of RAM.
+// Each IntArduPar keeps its name, bounds and eeprom adress in RAM. On small boards with many settings, that adds up.
+// A TableArduPar reads all of this from a table in PROGMEM, so each setting only needs RAM for its value.
+// The names in the table have to be sorted alphabetically.
+//
+// This example code is in the public domain.
+
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+int accel;
+int jerk;
+int speed;
+
+const char accelName[] PROGMEM="accel";
+const char jerkName[] PROGMEM="jerk";
+const char speedName[] PROGMEM="speed";
+
+// name, variable, lowest value, highest value, store in eeprom?
+const ArduParDescriptor<int> motorDescriptors[] PROGMEM={
+  {accelName,&accel,0,100,true},
+  {jerkName,&jerk,0,10,false},
+  {speedName,&speed,0,1000,true},
+};
+
+TableArduPar<int,3> motorSettings;
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+  motorSettings.setup(F("motor"),motorDescriptors);
+}
+
+void loop(){
+  //Enter i.e. "speed 10" into the serial monitor to set the parameter to a new value.
+  updateParametersFromStream(&Serial,10);
+
+  Serial.print("accel: ");
+  Serial.print(accel);
+  Serial.print("\tjerk: ");
+  Serial.print(jerk);
+  Serial.print("\tspeed: ");
+  Serial.println(speed);
+  delay(200);
+}
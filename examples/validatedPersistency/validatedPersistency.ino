@@ -0,0 +1,31 @@
+// Shows how to load persistent settings in one checked pass instead of trusting whatever is in the eeprom.
+// Settings that are set up between beginParameterImage() and loadParameterImage() keep the values they had before setup().
+// loadParameterImage() then reads all of them at once and checks a hash of the setting names and a crc.
+// On a new chip, or after settings were added or removed, the defaults are used and stored. Single values out of bounds are replaced by their default.
+//
+// This example code is in the public domain.
+
+#include <ArduPar.h>
+#include <avr/eeprom.h>
+
+IntArduPar brightnessSetting;
+FloatArduPar gainSetting;
+
+void setup(){
+  Serial.begin(115200);  //start Serial Communication
+
+  //the defaults
+  brightnessSetting.value=128;
+  gainSetting.value=1.0;
+
+  beginParameterImage();
+  brightnessSetting.setup(F("brightness"),0,255);
+  gainSetting.setup(F("gain"),0,10);
+  if(!loadParameterImage())Serial.println("using defaults");
+}
+
+void loop(){
+  //Enter i.e. "brightness 10" into the serial monitor, then reset the board.
+  updateParametersFromStream(&Serial,10);
+  analogWrite(9,brightnessSetting.value);
+}
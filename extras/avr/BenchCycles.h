@@ -0,0 +1,78 @@
+// Cycle counting for the benchmarks that run under simavr. Included by the benchmark sketches.
+//
+// Timer1 counts every CPU cycle, its overflows are counted by an interrupt. While a measurement runs,
+// the millis() interrupt is off, so nothing else adds cycles. Results go to Serial as "label<TAB>cycles" lines.
+#pragma once
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+// every measurement repeats the statement this many times and reports the average
+#ifndef BENCH_REPEAT
+#define BENCH_REPEAT 32
+#endif
+
+volatile uint16_t benchTimerOverflows;
+ISR(TIMER1_OVF_vect){benchTimerOverflows++;}
+uint32_t benchLoopCycles=0;	///< cycles of BENCH_REPEAT rounds of an empty loop, subtracted from all results
+
+void startCycleCounter(){
+  Serial.flush();			//no transmit interrupts while measuring
+  TIMSK0=0;
+  TCCR1A=0;
+  TCCR1B=0;
+  TCNT1=0;
+  benchTimerOverflows=0;
+  TIFR1=_BV(TOV1);
+  TIMSK1=_BV(TOIE1);
+  TCCR1B=_BV(CS10);		//no prescaler: one count per cycle
+}
+
+uint32_t stopCycleCounter(){
+  TCCR1B=0;
+  uint32_t cycles=((uint32_t)benchTimerOverflows<<16)|TCNT1;
+  if(TIFR1&_BV(TOV1))cycles+=65536UL;	//overflow that was not serviced before the timer stopped
+  TIMSK1=0;
+  TIMSK0=_BV(TOIE0);
+  return cycles;
+}
+
+/// print a result line. Cycles are per repetition.
+void reportCycles(const __FlashStringHelper* label, uint32_t cycles){
+  Serial.print(label);
+  Serial.print('\t');
+  Serial.println(cycles>benchLoopCycles?(cycles-benchLoopCycles)/BENCH_REPEAT:0);
+}
+
+/// Run "statement" BENCH_REPEAT times and print the average number of cycles. "benchRound" counts the repetitions.
+#define BENCH(label,statement) do{ \
+  startCycleCounter(); \
+  for(uint16_t benchRound=0;benchRound<BENCH_REPEAT;benchRound++){statement;} \
+  reportCycles(F(label),stopCycleCounter()); \
+}while(0)
+
+/// measure the loop itself, so that it can be subtracted
+void calibrateCycleCounter(){
+  startCycleCounter();
+  for(uint16_t benchRound=0;benchRound<BENCH_REPEAT;benchRound++){asm volatile("");}
+  benchLoopCycles=stopCycleCounter();
+}
+
+/// bytes between the heap and the stack
+int benchFreeRam(){
+  extern int __heap_start,*__brkval;
+  int v;
+  return (int)&v-(__brkval==0?(int)&__heap_start:(int)__brkval);
+}
+
+/// tell simavr that the benchmark is done. It stops when the CPU sleeps with interrupts disabled.
+void endBenchmark(){
+  Serial.print(F("free_ram\t"));
+  Serial.println(benchFreeRam());
+  Serial.println(F("done"));
+  Serial.flush();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  cli();
+  sleep_cpu();
+}
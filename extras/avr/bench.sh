@@ -0,0 +1,25 @@
+#!/bin/sh
+# Runs benchmark sketches under simavr and prints their results as tab separated lines:
+#   scenario  metric  value
+# "metric" is a label printed by the sketch (value in cycles), "free_ram" (bytes between heap and stack),
+# "flash" (program bytes) or "sram" (bytes of static data). The scenario is the name of the elf file.
+# Usage: bench.sh build/int_n8.elf ...
+SIMAVR=${SIMAVR:-simavr}
+MCU=${MCU:-atmega328p}
+F_CPU=${F_CPU:-16000000}
+F_CPU=${F_CPU%L}
+
+printf 'scenario\tmetric\tvalue\n'
+for elf in "$@"; do
+  scenario=$(basename "$elf" .elf)
+  #simavr colors what the sketch prints and adds messages of its own
+  output=$(timeout 120 "$SIMAVR" -m "$MCU" -f "$F_CPU" "$elf" 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
+  if ! printf '%s\n' "$output" | grep -q '^done'; then
+    echo "$scenario did not finish" >&2
+    exit 1
+  fi
+  printf '%s\n' "$output" | grep -E '^[a-z_0-9]+	[0-9]+$' | sed "s/^/$scenario	/"
+  avr-size -A "$elf" | awk -v s="$scenario" '
+    $1==".text"{text=$2} $1==".data"{data=$2} $1==".bss"{bss=$2}
+    END{printf "%s\tflash\t%d\n%s\tsram\t%d\n",s,text+data,s,data+bss}'
+done
@@ -0,0 +1,40 @@
+// Cycles of the building blocks that commands are made of: number conversions, bounds, the virtual call and eeprom access.
+// Prints one "label<TAB>cycles" line for each.
+#include <ArduPar.h>
+#include "BenchCycles.h"
+
+IntArduPar intSetting;
+FloatArduPar floatSetting;
+char intText[]=" 12345";
+char floatText[]=" 123.456";
+char fixedText[]=" 123.456";
+volatile int intSink;
+volatile long longSink;
+volatile float floatSink;
+volatile int intInput=1234;
+volatile float floatInput=12.5;
+uint8_t eepromData[4]={1,2,3,4};
+
+void setup(){
+  Serial.begin(115200);
+  calibrateCycleCounter();
+  intSetting.setup(F("int"),0,1000,false);
+  floatSetting.setup(F("float"),0,100,false);
+  AbstractArduPar* par=&intSetting;
+
+  BENCH("atoi",intSink=atoi(intText));
+  BENCH("atol",longSink=atol(intText));
+  BENCH("atof",floatSink=atof(floatText));
+  BENCH("parseFixedPoint_q8_8",longSink=parseFixedPoint(fixedText,8));
+  BENCH("constrain_int",intSink=constrain(intInput,0,1000));
+  BENCH("constrain_float",floatSink=constrain(floatInput,0.0f,10.0f));
+  BENCH("setValue_int",intSetting.setValue(intInput));
+  BENCH("parseParameterString_virtual",par->parseParameterString(intText));
+  BENCH("findParameter",longSink=(long)findParameter("int",3));
+  BENCH("eeprom_write_block_4",eeprom_write_block(eepromData,(void*)16,4));
+  BENCH("eeprom_update_block_4_unchanged",eeprom_update_block(eepromData,(void*)16,4));
+  endBenchmark();
+}
+
+void loop(){
+}
@@ -0,0 +1,97 @@
+// Cycles needed to handle one command, for a sketch with BENCH_SETTINGS settings of one type.
+// Built once for every scenario in the Makefile, with these defines:
+//   BENCH_SETTINGS      number of settings, 0 for a sketch that only has the library and Serial
+//   BENCH_TYPE          BENCH_INT, BENCH_LONG, BENCH_FLOAT, BENCH_FIXED or BENCH_STRING
+//   BENCH_NAME_LENGTH   length of the setting names: 4, 8 or 16
+//   BENCH_PERSISTENT    1 to store the values in eeprom
+// Prints:
+//   dispatch          dispatchParameterCommand(), as used by updateParametersFromStream()
+//   dispatch_linear   handing the command to every setting's parseSerialData(), the lookup the library used before the index
+//   parse             the virtual parseParameterString() of the setting alone
+#define BENCH_INT 1
+#define BENCH_LONG 2
+#define BENCH_FLOAT 3
+#define BENCH_FIXED 4
+#define BENCH_STRING 5
+
+#ifndef BENCH_SETTINGS
+#define BENCH_SETTINGS 8
+#endif
+#ifndef BENCH_TYPE
+#define BENCH_TYPE BENCH_INT
+#endif
+#ifndef BENCH_NAME_LENGTH
+#define BENCH_NAME_LENGTH 8
+#endif
+#ifndef BENCH_PERSISTENT
+#define BENCH_PERSISTENT 0
+#endif
+
+#define PAR_SETTINGS_MAX_NUMBER (BENCH_SETTINGS+1)
+#include <ArduPar.h>
+#include "BenchCycles.h"
+
+#if BENCH_SETTINGS>0
+
+//names are a prefix and two octal digits, so all of them have the same length
+#if BENCH_NAME_LENGTH==4
+#define BENCH_PREFIX "ab"
+#elif BENCH_NAME_LENGTH==8
+#define BENCH_PREFIX "abcdef"
+#else
+#define BENCH_PREFIX "abcdefghijklmn"
+#endif
+#define BENCH_NAMES8(a) BENCH_PREFIX #a "0",BENCH_PREFIX #a "1",BENCH_PREFIX #a "2",BENCH_PREFIX #a "3",BENCH_PREFIX #a "4",BENCH_PREFIX #a "5",BENCH_PREFIX #a "6",BENCH_PREFIX #a "7"
+const char benchNames[64][BENCH_NAME_LENGTH+1] PROGMEM={
+  BENCH_NAMES8(0),BENCH_NAMES8(1),BENCH_NAMES8(2),BENCH_NAMES8(3),BENCH_NAMES8(4),BENCH_NAMES8(5),BENCH_NAMES8(6),BENCH_NAMES8(7)
+};
+
+#if BENCH_TYPE==BENCH_INT
+IntArduPar settings[BENCH_SETTINGS];
+#define BENCH_VALUES {" 123"," 456"}
+#define SETUP_SETTING(i) settings[i].setup((const __FlashStringHelper*)benchNames[i],0,1000,BENCH_PERSISTENT)
+#elif BENCH_TYPE==BENCH_LONG
+LongArduPar settings[BENCH_SETTINGS];
+#define BENCH_VALUES {" 123456"," 654321"}
+#define SETUP_SETTING(i) settings[i].setup((const __FlashStringHelper*)benchNames[i],0,1000000,BENCH_PERSISTENT)
+#elif BENCH_TYPE==BENCH_FLOAT
+FloatArduPar settings[BENCH_SETTINGS];
+#define BENCH_VALUES {" 12.5"," 7.25"}
+#define SETUP_SETTING(i) settings[i].setup((const __FlashStringHelper*)benchNames[i],0,100,BENCH_PERSISTENT)
+#elif BENCH_TYPE==BENCH_FIXED
+FixedArduPar<int16_t,8> settings[BENCH_SETTINGS];
+#define BENCH_VALUES {" 12.5"," 7.25"}
+#define SETUP_SETTING(i) settings[i].setup((const __FlashStringHelper*)benchNames[i],FIXED_POINT(0,8),FIXED_POINT(100,8),BENCH_PERSISTENT)
+#else
+StringArduPar settings[BENCH_SETTINGS];
+char stringValues[BENCH_SETTINGS][8];
+#define BENCH_VALUES {" hello"," world"}
+#define SETUP_SETTING(i) settings[i].setup((const __FlashStringHelper*)benchNames[i],stringValues[i],8,BENCH_PERSISTENT)
+#endif
+
+const char* const benchValues[2]=BENCH_VALUES;
+char commands[2][BENCH_NAME_LENGTH+12];	///< two commands for the last setting, with different values so that eeprom is written every time
+char values[2][12];
+#endif
+
+void setup(){
+  Serial.begin(115200);
+  calibrateCycleCounter();
+#if BENCH_SETTINGS>0
+  for(int i=0;i<BENCH_SETTINGS;i++)SETUP_SETTING(i);
+  for(int i=0;i<2;i++){
+    strcpy_P(commands[i],benchNames[BENCH_SETTINGS-1]);
+    strcat(commands[i],benchValues[i]);
+    strcpy(values[i],benchValues[i]);
+  }
+  AbstractArduPar* par=PAR_SETTINGS_INSTANCES[BENCH_SETTINGS-1];
+  dispatchParameterCommand(commands[0]);	//builds the index
+  BENCH("dispatch",dispatchParameterCommand(commands[benchRound&1]));
+  BENCH("dispatch_linear",for(int i=0;i<BENCH_SETTINGS;i++)PAR_SETTINGS_INSTANCES[i]->parseSerialData(commands[benchRound&1]));
+  BENCH("parse",par->parseParameterString(values[benchRound&1]));
+#endif
+  endBenchmark();
+}
+
+void loop(){
+}
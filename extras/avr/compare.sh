@@ -0,0 +1,15 @@
+#!/bin/sh
+# Compares two result files of bench.sh and prints every value that changed, with the change in percent.
+# Usage: compare.sh old.tsv new.tsv
+if [ $# -ne 2 ]; then
+  echo "usage: compare.sh old.tsv new.tsv" >&2
+  exit 1
+fi
+awk -F'\t' '
+  NR==FNR{if(FNR>1)old[$1"\t"$2]=$3;next}
+  FNR==1{printf "scenario\tmetric\told\tnew\tchange_percent\n";next}
+  {
+    key=$1"\t"$2
+    if(!(key in old)){printf "%s\t\t%s\tnew\n",key,$3;next}
+    if(old[key]!=$3)printf "%s\t%s\t%s\t%+.1f\n",key,old[key],$3,old[key]==0?0:($3-old[key])*100.0/old[key]
+  }' "$1" "$2"
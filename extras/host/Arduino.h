@@ -0,0 +1,93 @@
+// Minimal stand-in for the Arduino core so ArduPar can be compiled and measured on a Linux host.
+// Only the parts the library actually uses are provided.
+// Created 2026 for the ArduPar host build. This code is in the public domain.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <avr/pgmspace.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+char* ultoa(unsigned long value, char* buffer, int radix);	///< from avr-libc's stdlib.h
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void hostSetClock(unsigned long micros);	///< freezes the clock at the given time. Useful for reproducible scripted runs.
+void hostAdvanceClock(unsigned long micros);	///< advances a frozen clock
+void hostUseRealClock();	///< go back to the real time clock of the host
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout);
+
+/// output part of the Arduino stream classes
+class Print{
+public:
+  virtual ~Print(){}
+  virtual size_t write(uint8_t c)=0;
+  virtual size_t write(const uint8_t* buffer, size_t size){
+    size_t n=0;
+    while(size--)n+=write(*buffer++);
+    return n;
+  }
+  size_t write(const char* str){return write((const uint8_t*)str,strlen(str));}
+  size_t write(const char* buffer, size_t size){return write((const uint8_t*)buffer,size);}
+
+  size_t print(const __FlashStringHelper* s){return write((const char*)s);}
+  size_t print(const char* s){return write(s);}
+  size_t print(char c){return write((uint8_t)c);}
+  size_t print(int n){return printSigned(n);}
+  size_t print(unsigned int n){return printUnsigned(n);}
+  size_t print(long n){return printSigned(n);}
+  size_t print(unsigned long n){return printUnsigned(n);}
+  size_t print(double n,int digits=2){char buf[32];dtostrf(n,1,digits,buf);return write(buf);}
+  template<typename T> size_t println(T x){size_t n=print(x);return n+println();}
+  size_t println(){return write("\r\n");}
+private:
+  size_t printSigned(long long n){return write(std::to_string(n).c_str());}
+  size_t printUnsigned(unsigned long long n){return write(std::to_string(n).c_str());}
+};
+
+/// input and output part of the Arduino stream classes
+class Stream: public Print{
+public:
+  virtual int available()=0;
+  virtual int read()=0;
+  virtual int peek()=0;
+};
+
+/// A stream that reads from a string and collects everything written to it.
+/// Used to script input for the library and to inspect its output.
+class HostStream: public Stream{
+public:
+  std::string input;    ///< data that will be returned by read()
+  size_t readPos;       ///< position of the next char in input
+  std::string output;   ///< everything that was written
+  bool echo;            ///< also copy output to stdout
+  size_t writeCalls;    ///< number of write() calls, to measure how chatty output is
+
+  HostStream():readPos(0),echo(false),writeCalls(0){}
+  void feed(const char* data){input.append(data);}
+  void feed(const uint8_t* data,size_t size){input.append((const char*)data,size);}
+  virtual int available(){return (int)(input.size()-readPos);}
+  virtual int read(){return readPos<input.size()?(uint8_t)input[readPos++]:-1;}
+  virtual int peek(){return readPos<input.size()?(uint8_t)input[readPos]:-1;}
+  virtual size_t write(uint8_t c){return write(&c,1);}
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+};
+
+extern HostStream Serial;
@@ -0,0 +1,105 @@
+// Implementation of the host stand-ins for the Arduino core and avr-libc.
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include "Arduino.h"
+#include <avr/eeprom.h>
+
+HostStream Serial;
+
+static bool hostClockFrozen=false;
+static unsigned long hostFrozenMicros=0;
+
+unsigned long micros(){
+  if(hostClockFrozen)return hostFrozenMicros;
+  static std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-start).count();
+}
+unsigned long millis(){return micros()/1000;}
+void delay(unsigned long ms){
+  if(hostClockFrozen){hostFrozenMicros+=ms*1000;return;}
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+void hostSetClock(unsigned long us){hostClockFrozen=true;hostFrozenMicros=us;}
+void hostAdvanceClock(unsigned long us){hostFrozenMicros+=us;}
+void hostUseRealClock(){hostClockFrozen=false;}
+
+char* ultoa(unsigned long value, char* buffer, int radix){
+  char digits[sizeof(value)*8+1];
+  int n=0;
+  do{
+    int digit=value%radix;
+    digits[n++]=digit<10?'0'+digit:'a'+digit-10;
+    value/=radix;
+  }while(value>0);
+  for(int i=0;i<n;i++)buffer[i]=digits[n-1-i];
+  buffer[n]=0;
+  return buffer;
+}
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout){
+  sprintf(sout,"%*.*f",width,prec,val);
+  return sout;
+}
+
+size_t HostStream::write(const uint8_t* buffer, size_t size){
+  writeCalls++;
+  output.append((const char*)buffer,size);
+  if(echo)fwrite(buffer,1,size,stdout);
+  return size;
+}
+
+uint8_t hostEepromImage[E2END+1];
+unsigned long hostEepromBytesWritten=0;
+unsigned long hostEepromWriteCalls=0;
+static struct HostEepromInit{HostEepromInit(){hostEepromErase();}} hostEepromInit;
+
+void hostEepromErase(){memset(hostEepromImage,0xFF,sizeof(hostEepromImage));}
+bool hostEepromLoad(const char* fileName){
+  FILE* f=fopen(fileName,"rb");
+  if(!f)return false;
+  size_t n=fread(hostEepromImage,1,sizeof(hostEepromImage),f);
+  fclose(f);
+  return n==sizeof(hostEepromImage);
+}
+bool hostEepromSave(const char* fileName){
+  FILE* f=fopen(fileName,"wb");
+  if(!f)return false;
+  size_t n=fwrite(hostEepromImage,1,sizeof(hostEepromImage),f);
+  fclose(f);
+  return n==sizeof(hostEepromImage);
+}
+
+static size_t hostEepromCheck(const void* adress, size_t n){
+  size_t a=(size_t)adress;
+  if(a>E2END||n>E2END+1-a){
+    fprintf(stderr,"EEPROM access out of range: %zu+%zu\n",a,n);
+    abort();
+  }
+  return a;
+}
+uint8_t eeprom_read_byte(const uint8_t* adress){return hostEepromImage[hostEepromCheck(adress,1)];}
+void eeprom_write_byte(uint8_t* adress, uint8_t value){
+  hostEepromImage[hostEepromCheck(adress,1)]=value;
+  hostEepromBytesWritten++;
+  hostEepromWriteCalls++;
+}
+void eeprom_update_byte(uint8_t* adress, uint8_t value){
+  size_t a=hostEepromCheck(adress,1);
+  hostEepromWriteCalls++;
+  if(hostEepromImage[a]!=value){hostEepromImage[a]=value;hostEepromBytesWritten++;}
+}
+void eeprom_read_block(void* dst, const void* src, size_t n){memcpy(dst,hostEepromImage+hostEepromCheck(src,n),n);}
+void eeprom_write_block(const void* src, void* dst, size_t n){
+  memcpy(hostEepromImage+hostEepromCheck(dst,n),src,n);
+  hostEepromBytesWritten+=n;
+  hostEepromWriteCalls++;
+}
+void eeprom_update_block(const void* src, void* dst, size_t n){
+  size_t a=hostEepromCheck(dst,n);
+  hostEepromWriteCalls++;
+  for(size_t i=0;i<n;i++){
+    uint8_t v=((const uint8_t*)src)[i];
+    if(hostEepromImage[a+i]!=v){hostEepromImage[a+i]=v;hostEepromBytesWritten++;}
+  }
+}
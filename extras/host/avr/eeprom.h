@@ -0,0 +1,23 @@
+// Host stand-in for the avr-libc EEPROM functions. The EEPROM is emulated by a RAM image.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef E2END
+#define E2END 1023	///< last EEPROM adress, like on the ATmega328P
+#endif
+
+extern uint8_t hostEepromImage[E2END+1];	///< contents of the emulated EEPROM. Erased cells read 0xFF.
+extern unsigned long hostEepromBytesWritten;	///< counts physical byte writes, to judge wear and stall time
+extern unsigned long hostEepromWriteCalls;	///< counts calls of the write functions
+
+void hostEepromErase();	///< set all cells to 0xFF like a freshly erased chip
+bool hostEepromLoad(const char* fileName);	///< fill the image from a file
+bool hostEepromSave(const char* fileName);	///< write the image to a file
+
+uint8_t eeprom_read_byte(const uint8_t* adress);
+void eeprom_write_byte(uint8_t* adress, uint8_t value);
+void eeprom_update_byte(uint8_t* adress, uint8_t value);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+void eeprom_write_block(const void* src, void* dst, size_t n);
+void eeprom_update_block(const void* src, void* dst, size_t n);
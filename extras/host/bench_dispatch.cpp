@@ -0,0 +1,52 @@
+// Measures how long it takes to dispatch one serial command, for different numbers of settings.
+// Compares the indexed lookup used by updateParametersFromStream() to handing the command to every instance,
+// which is what the library did before the index existed.
+// Usage: bench_dispatch <number of settings>
+// Prints one line: number of settings, ns per command with the old linear scan, ns per command with the index.
+#include <chrono>
+#include <stdio.h>
+#define PAR_SETTINGS_MAX_NUMBER 256
+#include "ArduPar.h"
+
+IntArduPar settings[PAR_SETTINGS_MAX_NUMBER];
+char names[PAR_SETTINGS_MAX_NUMBER][16];
+char commands[PAR_SETTINGS_MAX_NUMBER][PAR_SETTINGS_BUFFER_SIZE];
+
+/// the old way: every instance compares the command to its own name
+void dispatchLinear(char* command){
+  for(int i=0;i<PAR_SETTINGS_CUR_INSTANCE_NUMBER;i++){
+    PAR_SETTINGS_INSTANCES[i]->parseSerialData(command);
+  }
+}
+
+template<typename F> double nanosPerCommand(int numSettings, F dispatch){
+  const int rounds=2000000/numSettings+1;
+  char buf[PAR_SETTINGS_BUFFER_SIZE];
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  for(int r=0;r<rounds;r++){
+    for(int i=0;i<numSettings;i++){
+      strcpy(buf,commands[(i*7)%numSettings]);	//dispatching may modify the buffer, like the stream parser's
+      dispatch(buf);
+    }
+  }
+  double elapsed=std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count();
+  return elapsed/((double)rounds*numSettings);
+}
+
+int main(int argc, char** argv){
+  int numSettings=argc>1?atoi(argv[1]):32;
+  numSettings=constrain(numSettings,1,PAR_SETTINGS_MAX_NUMBER);
+  for(int i=0;i<numSettings;i++){
+    //names of different lengths with common prefixes, like real sketches tend to have
+    snprintf(names[i],sizeof(names[i]),"%s%u",i%3==0?"motor":(i%3==1?"motorSpeed":"led"),(unsigned)i%1000);
+    snprintf(commands[i],sizeof(commands[i]),"%.15s %d",names[i],i);
+    settings[i].setup((const __FlashStringHelper*)names[i],0,1000,false);
+  }
+  double linear=nanosPerCommand(numSettings,dispatchLinear);
+  double indexed=nanosPerCommand(numSettings,dispatchParameterCommand);
+  for(int i=0;i<numSettings;i++){
+    if(settings[i].value!=i){printf("setting %s has wrong value %d\n",names[i],settings[i].value);return 1;}
+  }
+  printf("%d\t%.1f\t%.1f\n",numSettings,linear,indexed);
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Measures how long it takes to set a FloatArduPar and a FixedArduPar from a received string.
+// The float setting converts with atof() and constrains a float, the fixed point one does both with integers.
+// Prints one line: ns per value for FloatArduPar, FixedArduPar<int16_t,8> and FixedArduPar<long,16>.
+// On a host with a floating point unit the difference is much smaller than on AVR, where floats are emulated in software.
+#include <chrono>
+#include <stdio.h>
+#include "ArduPar.h"
+
+FloatArduPar floatSetting;
+FixedArduPar<int16_t,8> q8Setting;
+FixedArduPar<long,16> q16Setting;
+
+const char* values[]={"0.5","-12.375","99.9","3","-0.0625","42.42","7.125","-100"};
+const int numValues=sizeof(values)/sizeof(values[0]);
+
+double nanosPerValue(AbstractArduPar* setting){
+  const int rounds=500000;
+  char buf[PAR_SETTINGS_BUFFER_SIZE];
+  std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+  for(int r=0;r<rounds;r++){
+    for(int i=0;i<numValues;i++){
+      strcpy(buf,values[i]);
+      setting->parseParameterString(buf);
+    }
+  }
+  double elapsed=std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count();
+  return elapsed/((double)rounds*numValues);
+}
+
+int main(){
+  floatSetting.setup(F("float"),-50,50,false);
+  q8Setting.setup(F("q8"),FIXED_POINT(-50,8),FIXED_POINT(50,8),false);
+  q16Setting.setup(F("q16"),FIXED_POINT(-50,16),FIXED_POINT(50,16),false);
+  double floatNanos=nanosPerValue(&floatSetting);
+  double q8Nanos=nanosPerValue(&q8Setting);
+  double q16Nanos=nanosPerValue(&q16Setting);
+  if(q16Setting.value!=FIXED_POINT(-50,16)||floatSetting.value!=-50){printf("wrong value after parsing\n");return 1;}
+  printf("%.1f\t%.1f\t%.1f\n",floatNanos,q8Nanos,q16Nanos);
+  return 0;
+}
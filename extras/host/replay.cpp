@@ -0,0 +1,424 @@
+// Runs ArduPar on the host with one setting of every type and feeds it commands from a script.
+// Everything the library prints goes to stdout, so runs can be compared with diff.
+//
+// Usage: replay [-e eeprom.bin] [-z] [-l] [-L size] [-i] [-S budget] [-s group]... [script]
+//   -e  load the emulated EEPROM from this file at start and save it at the end. Use it to check persistence across runs.
+//   -z  start with an eeprom that is all zeros instead of erased, so settings that were never stored read as 0
+//   -l  keep the settings in the wear leveled log (beginParameterLog) instead of fixed adresses
+//   -L  like -l, with a log of the given size in bytes at eeprom adress 0, so it fills up and gets compacted soon
+//   -i  load the settings from a validated parameter image (beginParameterImage and loadParameterImage)
+//   -S  defer persistence and do all the work with serviceParameters(budget) instead of updateParametersFromStream()
+//   -s  also set up the settings of a group, after the ones every run has. Groups:
+//         array   ArrayArduPar<int> someArray[4] 0..1000 and ArrayArduPar<uint8_t> someBytes[4] 10..200
+//         fixed   IntArduPar fixedInt 0..255 at the fixed eeprom adress 1000
+//         arena   ArenaStringArduPar someName (12 chars, "arduino" by default) and someHost (16 chars, "host") in a 24 byte ArduParStringArena
+//         bits    BoolArduPar someBool, BoolArduPar someFlag and EnumArduPar someMode off|slow|fast in a 2 byte ArduParBitField
+//         curve   CurveArduPar<3> someCurve with inputs 0..1023 and outputs 0..255
+//         osc     IntArduPar /osc/a 0..100, FloatArduPar /osc/b 0..10 and IntArduPar /osc/c 0..100, with names that OSC adresses can reach
+//         table   TableArduPar<int,3> someTable with accel 0..100, jerk 0..10 (not stored) and speed 0..1000
+//         feedback an ArduParFeedbackPublisher that writes to Serial, at most every 10ms and 1000 bytes/s. It runs in the loop.
+//         changes change callbacks on someInt and someLong, and a change group of someFloat and someString. Each call is printed.
+//                 dispatchParameterChanges() runs in the loop.
+//         long    StringArduPar someLongString of up to 47 chars, whose dump line does not fit the dump buffer
+//         published PublishedArduPar<LongArduPar> somePublished 0..100000 and PublishedArduPar<FixedArduPar<long,16>> somePublishedFixed -10..10
+//         derived DerivedArduPar<long> someDouble=2*someLong and someQuad=2*someDouble. Each computation is printed.
+//         presets PresetBankArduPar preset with 3 slots for all settings before it, so give it last. Fades run in the loop.
+// The script is read from stdin if no file is given. Each line is sent to the library as it would arrive over Serial.
+// Lines starting with "!" are directives for the replay itself:
+//   !wait <ms>     let the given time pass. The clock is frozen otherwise, so runs are reproducible.
+//   !chunk <n>     from now on, deliver input in pieces of n bytes, one piece per loop, to exercise partial commands
+//   !send <text>   deliver the text without a line break, like a terminal that sends no line endings
+//   !eeprom        print the number of EEPROM bytes written so far
+//   !loop <n>      run n more passes of the loop, 1ms each
+//   !report        print the report of serviceParameters()
+//   !poke <adress> <hex>  overwrite an eeprom byte, i.e. to damage stored values for the next run
+//   !frame <hex>   deliver a binary frame with the given bytes, like "00 69 05 00" for someInt 5. The crc is added and the frame is SLIP encoded.
+//   !bytes <hex>   deliver the given bytes as they are
+//   !arena         print the footprint of the strings in the arena
+//   !set <value>...  set someInt to each value with setValue(), like the firmware would, all before the next loop pass
+//   !begin, !end   beginParameterBatch() and endParameterBatch()
+//   !ramp <from> <to> [long]  set someInt (and someLong with "long") to each value from <from> to <to> with setValue(), one per loop pass
+//   !feedback      print the number of bytes the feedback publisher sent so far
+//   !changed       dump the settings that changed since the last !changed, with dumpChangedParameterInfos()
+//   !page <first> <count>  dump "count" settings from instance "first" on and print where the next page starts
+//   !writes        print the number of write() calls to Serial since the last !writes
+//   !read          print what interrupt routines would read from the published settings, the fixed point one as raw value
+//   !stats [0]     print the statistics with dumpParameterStats(), and reset them with "0". Only in build/replay_stats,
+//                  which is built with PAR_SETTINGS_STATS=1.
+//   !curve <x>...  print the output of someCurve for each input
+//   !osc [@<seconds>] <adress> [<tag> <value>] [; <adress> [<tag> <value>]]...
+//                  hand an OSC packet to dispatchOscPacket(). Tags are i, f, s, T and F. Several messages, or a timetag of
+//                  <seconds> NTP time, make a bundle. An empty adress makes a message that is no valid OSC.
+//   !oscbytes <hex>  hand the given bytes to dispatchOscPacket(), for broken packets
+//   !oscsync <seconds>  tell the library that the NTP time is <seconds> now, with syncOscTime()
+// Lines starting with "#" are ignored.
+#include <stdio.h>
+#include <string>
+#include "ArduPar.h"
+
+IntArduPar someIntSetting;
+LongArduPar someLongSetting;
+FloatArduPar someFloatSetting;
+StringArduPar someStringSetting;
+FixedArduPar<long,16> someFixedSetting;
+char someStringBuffer[20];
+CallbackArduPar dumpCallback;
+
+int someArrayValues[4];
+ArrayArduPar<int> someArray;
+uint8_t someBytesValues[4];
+ArrayArduPar<uint8_t> someBytes;
+IntArduPar fixedInt;
+uint8_t someArenaBuffer[24];
+ArduParStringArena someArena;
+ArenaStringArduPar someName;
+ArenaStringArduPar someHost;
+uint8_t someBits[2];
+ArduParBitField someBitField;
+BoolArduPar someBool;
+BoolArduPar someFlag;
+EnumArduPar someMode;
+CurveArduPar<3> someCurve;
+IntArduPar oscA;
+FloatArduPar oscB;
+IntArduPar oscC;
+int accel,jerk,speed;
+const char accelName[] PROGMEM="accel";
+const char jerkName[] PROGMEM="jerk";
+const char speedName[] PROGMEM="speed";
+const ArduParDescriptor<int> someTableDescriptors[] PROGMEM={
+  {accelName,&accel,0,100,true},
+  {jerkName,&jerk,0,10,false},
+  {speedName,&speed,0,1000,true},
+};
+TableArduPar<int,3> someTable;
+DerivedArduPar<long> someDouble;
+DerivedArduPar<long> someQuad;
+PresetBankArduPar presets;
+PublishedArduPar<LongArduPar> somePublished;
+PublishedArduPar<FixedArduPar<long,16> > somePublishedFixed;
+ArduParFeedbackPublisher feedback;
+char someLongStringBuffer[48];
+StringArduPar someLongString;
+bool useChanges=false;		///< true if the changes group was set up
+ArduParChangeGroup someGroup;
+bool useFeedback=false;		///< true if the feedback group was set up
+unsigned long feedbackBytes=0;	///< bytes sent by the feedback publisher
+bool usePresets=false;		///< true if the presets group was set up
+
+HostStream serialIn;		///< the stream the library reads commands from
+std::string pending;		///< script input that was not delivered to serialIn yet
+size_t chunkSize=0;		///< 0 delivers all pending input at once
+long serviceBudget=-1;		///< budget for serviceParameters(), -1 if it is not used
+
+void dumpToSerial(){dumpParameterInfos(&Serial);}
+
+long computeDouble(){Serial.println(F("computing someDouble"));return 2*someLongSetting.value;}
+long computeQuad(){Serial.println(F("computing someQuad"));return 2*someDouble.getValue();}
+
+void printChange(AbstractArduPar* changed){
+  ArduParArgument arg;
+  changed->getValueArgument(&arg);
+  Serial.print(F("changed "));
+  Serial.print(changed->cmdString);
+  Serial.print(F(" to "));
+  Serial.println(arg.asLong());
+}
+void printGroupChange(){
+  Serial.print(F("group changed: "));
+  Serial.print(someFloatSetting.value);
+  Serial.print(F(" "));
+  Serial.println(someStringBuffer);
+}
+
+/// set up the settings of the group with the given name. Returns false if there is no such group.
+bool setupGroup(const char* name){
+  if(strcmp(name,"array")==0){
+    someArray.setup(F("someArray"),someArrayValues,4,0,1000);
+    someBytes.setup(F("someBytes"),someBytesValues,4,10,200);
+  }
+  else if(strcmp(name,"fixed")==0)fixedInt.setup(F("fixedInt"),0,255,true,0,1000);
+  else if(strcmp(name,"arena")==0){
+    someArena.setup(someArenaBuffer,sizeof(someArenaBuffer));
+    someName.setup(F("someName"),&someArena,12,F("arduino"));
+    someHost.setup(F("someHost"),&someArena,16,F("host"));
+  }
+  else if(strcmp(name,"bits")==0){
+    someBitField.setup(someBits,sizeof(someBits));
+    someBool.setup(F("someBool"),&someBitField);
+    someFlag.setup(F("someFlag"),&someBitField);
+    someMode.setup(F("someMode"),F("off|slow|fast"),&someBitField);
+  }
+  else if(strcmp(name,"curve")==0)someCurve.setup(F("someCurve"),0,1023,0,255);
+  else if(strcmp(name,"osc")==0){
+    oscA.setup(F("/osc/a"),0,100);
+    oscB.setup(F("/osc/b"),0,10);
+    oscC.setup(F("/osc/c"),0,100);
+  }
+  else if(strcmp(name,"presets")==0){
+    presets.setup(F("preset"),3);
+    usePresets=true;
+  }
+  else if(strcmp(name,"table")==0)someTable.setup(F("someTable"),someTableDescriptors);
+  else if(strcmp(name,"published")==0){
+    somePublished.setup(F("somePublished"),0,100000);
+    somePublishedFixed.setup(F("somePublishedFixed"),FIXED_POINT(-10,16),FIXED_POINT(10,16));
+  }
+  else if(strcmp(name,"long")==0)someLongString.setup(F("someLongString"),someLongStringBuffer,sizeof(someLongStringBuffer));
+  else if(strcmp(name,"changes")==0){
+    someIntSetting.onChange(printChange);
+    someLongSetting.onChange(printChange);
+    someGroup.callback=printGroupChange;
+    someGroup.changePending=false;
+    someFloatSetting.setChangeGroup(&someGroup);
+    someStringSetting.setChangeGroup(&someGroup);
+    useChanges=true;
+  }
+  else if(strcmp(name,"feedback")==0){
+    feedback.setup(&Serial,10,1000);
+    useFeedback=true;
+  }
+  else if(strcmp(name,"derived")==0){
+    someDouble.setup(F("someDouble"),computeDouble,&someLongSetting);
+    someQuad.setup(F("someQuad"),computeQuad,&someDouble);
+  }
+  else return false;
+  return true;
+}
+
+/// the bytes of a list of hex numbers like "00 69 05 00"
+std::string parseHex(const char* text){
+  std::string bytes;
+  char* end;
+  for(long b=strtol(text,&end,16);end!=text;b=strtol(text,&end,16)){
+    bytes+=(char)b;
+    text=end;
+  }
+  return bytes;
+}
+
+/// a binary frame for dispatchParameterFrame(): the entries, their crc, SLIP encoded
+std::string encodeFrame(const std::string& entries){
+  std::string frame(1,(char)PAR_FRAME_END);
+  std::string data=entries+(char)crc8Update(0,(const uint8_t*)entries.data(),entries.size());
+  for(size_t i=0;i<data.size();i++){
+    uint8_t b=data[i];
+    if(b==PAR_FRAME_END){frame+=(char)PAR_FRAME_ESC;frame+=(char)PAR_FRAME_ESC_END;}
+    else if(b==PAR_FRAME_ESC){frame+=(char)PAR_FRAME_ESC;frame+=(char)PAR_FRAME_ESC_ESC;}
+    else frame+=(char)b;
+  }
+  return frame+(char)PAR_FRAME_END;
+}
+
+/// append a string, zero terminated and padded to a multiple of 4 bytes, as OSC wants it
+void appendOscString(std::string* packet, const std::string& text){
+  packet->append(text);
+  packet->append(4-text.size()%4,'\0');
+}
+
+/// append a 32 bit number in big endian order
+void appendOscInt32(std::string* packet, uint32_t value){
+  for(int shift=24;shift>=0;shift-=8)*packet+=(char)(value>>shift);
+}
+
+/// an OSC message from "<adress> [<tag> <value>]"
+std::string encodeOscMessage(const char* text){
+  char adress[64]="",tag[4]="",value[64]="";
+  sscanf(text,"%63s %3s %63s",adress,tag,value);
+  std::string message;
+  appendOscString(&message,adress);
+  if(tag[0]==0)return message;
+  appendOscString(&message,std::string(",")+tag[0]);
+  if(tag[0]=='i')appendOscInt32(&message,(uint32_t)atol(value));
+  else if(tag[0]=='f'){
+    float f=atof(value);
+    uint32_t bits;
+    memcpy(&bits,&f,4);
+    appendOscInt32(&message,bits);
+  }
+  else if(tag[0]=='s')appendOscString(&message,value);
+  return message;
+}
+
+/// an OSC packet from the arguments of the !osc directive
+std::string encodeOscPacket(const char* text){
+  while(*text==' ')text++;
+  bool bundle=(*text=='@');
+  uint32_t seconds=0,fraction=1;	//immediately
+  if(bundle){
+    seconds=strtoul(text+1,0,10);
+    fraction=0;
+    text=strchr(text,' ');
+  }
+  std::string messages[8];
+  int numMessages=0;
+  std::string rest(text?text:"");
+  size_t start=0;
+  while(numMessages<8){
+    size_t end=rest.find(';',start);
+    messages[numMessages++]=encodeOscMessage(rest.substr(start,end-start).c_str());
+    if(end==std::string::npos)break;
+    start=end+1;
+  }
+  if(!bundle&&numMessages==1)return messages[0];
+  std::string packet;
+  appendOscString(&packet,"#bundle");
+  appendOscInt32(&packet,seconds);
+  appendOscInt32(&packet,fraction);
+  for(int i=0;i<numMessages;i++){
+    appendOscInt32(&packet,messages[i].size());
+    packet+=messages[i];
+  }
+  return packet;
+}
+
+/// one pass of the "loop", which takes 1ms
+void loopOnce(){
+  size_t n=pending.size();
+  if(chunkSize>0&&chunkSize<n)n=chunkSize;
+  serialIn.feed((const uint8_t*)pending.data(),n);
+  pending.erase(0,n);
+  if(serviceBudget>=0)serviceParameters(serviceBudget);
+  else{
+    applyScheduledParameters();
+    updateParametersFromStream(&serialIn,10);
+  }
+  if(usePresets)presets.update();
+  if(useChanges)dispatchParameterChanges();
+  if(useFeedback)feedbackBytes+=feedback.update();
+  hostAdvanceClock(1000);
+}
+
+/// run the "loop" until all pending input was delivered and consumed
+void runLoop(){
+  do loopOnce();
+  while(!pending.empty()||serialIn.available()>0);
+}
+
+int main(int argc, char** argv){
+  const char* eepromFile=0;
+  const char* scriptFile=0;
+  bool useLog=false;
+  int logSize=-1;
+  bool useImage=false;
+  bool zeroEeprom=false;
+  const char* groups[8];
+  int numGroups=0;
+  for(int i=1;i<argc;i++){
+    if(strcmp(argv[i],"-e")==0&&i+1<argc)eepromFile=argv[++i];
+    else if(strcmp(argv[i],"-l")==0)useLog=true;
+    else if(strcmp(argv[i],"-L")==0&&i+1<argc){useLog=true;logSize=atoi(argv[++i]);}
+    else if(strcmp(argv[i],"-i")==0)useImage=true;
+    else if(strcmp(argv[i],"-z")==0)zeroEeprom=true;
+    else if(strcmp(argv[i],"-S")==0&&i+1<argc)serviceBudget=atol(argv[++i]);
+    else if(strcmp(argv[i],"-s")==0&&i+1<argc&&numGroups<8)groups[numGroups++]=argv[++i];
+    else scriptFile=argv[i];
+  }
+  if(zeroEeprom)memset(hostEepromImage,0,sizeof(hostEepromImage));
+  if(eepromFile)hostEepromLoad(eepromFile);
+  FILE* script=scriptFile?fopen(scriptFile,"r"):stdin;
+  if(!script){perror(scriptFile);return 1;}
+
+  hostSetClock(0);
+  Serial.echo=true;
+  if(useLog)beginParameterLog(logSize);
+  if(useImage)beginParameterImage();
+  someIntSetting.setup(F("someInt"),0,255);
+  someLongSetting.setup(F("someLong"),0,100000);
+  someFloatSetting.setup(F("someFloat"),0,2*PI);
+  someStringSetting.setup(F("someString"),someStringBuffer,sizeof(someStringBuffer));
+  someFixedSetting.setup(F("someFixed"),FIXED_POINT(-10,16),FIXED_POINT(10,16));
+  dumpCallback.setup(F("dump"),&dumpToSerial);
+  for(int i=0;i<numGroups;i++){
+    if(!setupGroup(groups[i])){fprintf(stderr,"unknown group: %s\n",groups[i]);return 1;}
+  }
+  if(useImage)loadParameterImage();
+  if(serviceBudget>=0){
+    PAR_SETTINGS_PERSISTENCE.deferred=true;
+    addParameterStream(&serialIn,10);
+  }
+
+  char line[256];
+  while(fgets(line,sizeof(line),script)){
+    if(line[0]=='#')continue;
+    if(line[0]=='!'){
+      runLoop();
+      if(strncmp(line,"!wait",5)==0){hostAdvanceClock(atol(line+5)*1000);runLoop();}
+      else if(strncmp(line,"!chunk",6)==0)chunkSize=atoi(line+6);
+      else if(strncmp(line,"!send ",6)==0){pending.append(line+6,strcspn(line+6,"\r\n"));runLoop();}
+      else if(strncmp(line,"!eeprom",7)==0)printf("eeprom bytes written: %lu\n",hostEepromBytesWritten);
+      else if(strncmp(line,"!loop",5)==0){for(int n=atoi(line+5);n>0;n--)loopOnce();}
+      else if(strncmp(line,"!report",7)==0)dumpServiceReport(&Serial);
+      else if(strncmp(line,"!poke ",6)==0){char* end;long adress=strtol(line+6,&end,10);hostEepromImage[adress]=strtol(end,0,16);}
+      else if(strncmp(line,"!frame ",7)==0){pending+=encodeFrame(parseHex(line+7));runLoop();}
+      else if(strncmp(line,"!bytes ",7)==0){pending+=parseHex(line+7);runLoop();}
+      else if(strncmp(line,"!set ",5)==0){
+        char* text=line+5;
+        char* end;
+        for(long v=strtol(text,&end,10);end!=text;v=strtol(text,&end,10)){
+          someIntSetting.setValue(v);
+          text=end;
+        }
+      }
+      else if(strncmp(line,"!begin",6)==0)beginParameterBatch();
+      else if(strncmp(line,"!end",4)==0)endParameterBatch();
+      else if(strncmp(line,"!ramp ",6)==0){
+        char* end;
+        long from=strtol(line+6,&end,10);
+        long to=strtol(end,&end,10);
+        bool alsoLong=strstr(end,"long")!=0;
+        for(long v=from;v<=to;v++){
+          someIntSetting.setValue(v);
+          if(alsoLong)someLongSetting.setValue(v);
+          loopOnce();
+        }
+      }
+      else if(strncmp(line,"!feedback",9)==0)printf("feedback bytes sent: %lu\n",feedbackBytes);
+      else if(strncmp(line,"!changed",8)==0)dumpChangedParameterInfos(&Serial);
+      else if(strncmp(line,"!page ",6)==0){
+        char* end;
+        int first=strtol(line+6,&end,10);
+        int next=dumpParameterInfos(&Serial,first,atoi(end));
+        printf("next page: %d\n",next);
+      }
+      else if(strncmp(line,"!writes",7)==0){printf("write calls: %lu\n",(unsigned long)Serial.writeCalls);Serial.writeCalls=0;}
+      else if(strncmp(line,"!read",5)==0)printf("read: %ld %ld\n",somePublished.read(),somePublishedFixed.read());
+#if PAR_SETTINGS_STATS
+      else if(strncmp(line,"!stats",6)==0){
+        char* arg=line+6;
+        dumpParameterStats(&Serial);
+        while(*arg==' ')arg++;
+        if(*arg=='0')resetParameterStats();
+      }
+#endif
+      else if(strncmp(line,"!arena",6)==0)someArena.dumpFootprint(&Serial);
+      else if(strncmp(line,"!curve ",7)==0){
+        char* text=line+7;
+        char* end;
+        for(long x=strtol(text,&end,10);end!=text;x=strtol(text,&end,10)){
+          printf("someCurve(%ld)=%d\n",x,someCurve.evaluate(x));
+          text=end;
+        }
+      }
+      else if(strncmp(line,"!oscbytes ",10)==0){
+        std::string packet=parseHex(line+10);
+        dispatchOscPacket((const uint8_t*)packet.data(),packet.size());
+        runLoop();
+      }
+      else if(strncmp(line,"!oscsync ",9)==0)syncOscTime(strtoul(line+9,0,10),0);
+      else if(strncmp(line,"!osc ",5)==0){
+        std::string packet=encodeOscPacket(line+5);
+        dispatchOscPacket((const uint8_t*)packet.data(),packet.size());
+        runLoop();
+      }
+      else fprintf(stderr,"unknown directive: %s",line);
+      continue;
+    }
+    pending.append(line);
+    runLoop();
+  }
+  runLoop();
+  flushParameters();
+  if(eepromFile&&!hostEepromSave(eepromFile)){perror(eepromFile);return 1;}
+  return 0;
+}